@@ -0,0 +1,230 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZW and LZWd comparison)
+ **/
+
+#include "lzwd_file.h"
+#include <pthread.h>
+
+#define CMP_USAGE_MSG "Usage: ./lzwcmp <filename-to-compare> [options]\nOptions:\n -d: debug mode\n -e: entropy code the output indexes\n -l <level>: parsing level of lzwd, 0 (greedy) to 9 (full flexible parsing)\n -s <block size>: reading block size\n -c <csv file>: save results of every block as CSV\n"
+
+int debugflag = 0; // if true use debug moode
+int sizeflag = 0;  // if true use costum block size
+int textflag = 0;  // unused, needed by lzwd_lib
+int parse_level = 0; // 0 for greedy parsing, higher levels look further ahead
+int dict_size = DICT_SIZE; // dictionary entries before it is cleared
+int dict_key_max = 0;      // no limit
+int pattern_max = 0;       // no limit
+int entropyflag = 0; // if true huffman code the output indexes
+
+// codificacao de um bloco por um dos algoritmos
+typedef struct encode_job {
+    int algorithm;
+    int *buffer_in;
+    int nbytes;
+    int *buffer_out;
+    int output_size; // indexes
+    int bytes;       // size the block takes in a compressed file
+    int resets;      // dictionary resets
+    double seconds;  // CPU time of the encoding thread
+} encode_job;
+
+// totais de um algoritmo
+typedef struct encode_totals {
+    long long indexes;
+    long long bytes;
+    long long resets;
+    double seconds;
+} encode_totals;
+
+/**
+ * @return CPU time used so far by the calling thread, in seconds
+ **/
+double thread_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Encodes one block with the algorithm of the job.
+ * @param arg encode_job
+ **/
+void *encode_thread(void *arg) {
+    encode_job *job = arg;
+    double start = thread_seconds();
+
+    job->resets = 0;
+    if (job->algorithm == ALGO_LZW)
+        job->output_size = lzw_encode(job->buffer_in, job->nbytes, job->buffer_out, &job->resets);
+    else
+        job->output_size = lzwd_encode(job->buffer_in, job->nbytes, job->buffer_out, &job->resets);
+    job->bytes = encoded_block_size(job->buffer_out, job->output_size);
+
+    job->seconds = thread_seconds() - start;
+    return NULL;
+}
+
+/**
+ * @return compressed size over source size
+ **/
+double ratio(long long bytes, long long src_size) {
+    return src_size ? (double)bytes / src_size : 1; // nothing to compress, nothing saved
+}
+
+/**
+ * @return source MB encoded per second
+ **/
+double throughput(long long src_size, double seconds) {
+    return seconds > 0 ? src_size / seconds / 1e6 : 0;
+}
+
+/**
+ * Adds the results of a block to the totals of its algorithm.
+ **/
+void add_totals(encode_totals *totals, encode_job *job) {
+    totals->indexes += job->output_size;
+    totals->bytes += job->bytes;
+    totals->resets += job->resets;
+    totals->seconds += job->seconds;
+}
+
+/**
+ * Outputs the totals of an algorithm.
+ **/
+void print_totals(char *name, encode_totals *totals, long long src_size) {
+    printf("%s: %lld bytes (%lld indexes) || Compression: %.2f %% || Throughput: %.2f MB/s || Dictionary resets: %lld\n",
+           name, totals->bytes, totals->indexes, (1 - ratio(totals->bytes, src_size)) * 100,
+           throughput(src_size, totals->seconds), totals->resets);
+}
+
+int main(int argc, char *argv[]) {
+
+    clock_t t_start = clock(), t_end; // clocks for executing time calculations
+    FILE *src_file, *csv_file = NULL;
+    int block_size = 0;
+    char *csv_name = NULL;
+
+    // 1. read and interpret the input
+    int opt;
+    while ((opt = getopt(argc, argv, "del:s:c:")) != -1) {
+        switch (opt) {
+        case 'd':
+            debugflag = 1;
+            printf(DEBUG_TXT "Program iniciated in debug mode.\n" RESET_TXT);
+            break;
+        case 'e':
+            entropyflag = 1;
+            printf(DEBUG_TXT "Using entropy coding of output indexes.\n" RESET_TXT);
+            break;
+        case 'l':
+            parse_level = atoi(optarg);
+            if (parse_level < 0 || parse_level > PARSE_LEVEL_MAX) {
+                printf("Invalid parsing level.\n%s\n", CMP_USAGE_MSG);
+                return 1;
+            }
+            printf(DEBUG_TXT "Using parsing level %d.\n" RESET_TXT, parse_level);
+            break;
+        case 's':
+            sizeflag = 1;
+            block_size = atoi(optarg);
+            if (block_size < 1) {
+                printf("Invalid block size.\n%s\n", CMP_USAGE_MSG);
+                return 1;
+            }
+            printf(DEBUG_TXT "Using costum block size of %d.\n" RESET_TXT, block_size);
+            break;
+        case 'c':
+            csv_name = optarg;
+            break;
+        case '?':
+            printf("%s\n", CMP_USAGE_MSG);
+            return 1;
+        default:
+            abort();
+        }
+    }
+    // faulty input check
+    if (argc - optind != 1) {
+        printf("%s\n", CMP_USAGE_MSG);
+        return 1;
+    }
+
+    // 2.OPEN SOURCE file
+    src_file = fopen(argv[optind], "rb");
+    if (!src_file) {
+        printf("Unable to open supplied file.\n");
+        return 1;
+    }
+    if (csv_name) {
+        csv_file = fopen(csv_name, "w");
+        if (!csv_file) {
+            printf("Unable to create CSV file.\n");
+            return 1;
+        }
+        fprintf(csv_file, "offset,size,lzw_bytes,lzw_ratio,lzw_mbps,lzw_resets,lzwd_bytes,lzwd_ratio,lzwd_mbps,lzwd_resets\n");
+    }
+
+    // 4. Block Read
+    if (!sizeflag) {
+        block_size = BLOCK_SIZE_DEFAULT;
+    }
+    size_t nbytes = 0; // quantity of bytes read in block
+    int *buffer_in = malloc(sizeof(int) * block_size);
+    encode_job jobs[2] = {{ALGO_LZW, buffer_in}, {ALGO_LZWD, buffer_in}};
+    jobs[0].buffer_out = malloc(sizeof(int) * block_size);
+    jobs[1].buffer_out = malloc(sizeof(int) * block_size);
+    encode_totals totals[2];
+    memset(totals, 0, sizeof(totals));
+    long long src_size = 0;
+    int block_count = 0;
+
+    printf("Author: Tiago & Joana\n");
+    time_t now;
+    time(&now); // get current date and time
+    printf("Time of execution: %s", ctime(&now));
+
+    // 5. loop blocks of bytes until EOF, every block is read once and encoded by both algorithms at the same time
+    while ((nbytes = fread(buffer_in, 1, block_size, src_file)) > 0) {
+        block_count++;
+
+        pthread_t threads[2];
+        for (int a = 0; a < 2; a++) {
+            jobs[a].nbytes = nbytes;
+            pthread_create(&threads[a], NULL, encode_thread, &jobs[a]);
+        }
+        for (int a = 0; a < 2; a++) {
+            pthread_join(threads[a], NULL);
+            add_totals(&totals[a], &jobs[a]);
+        }
+
+        printf("Block %d (offset %lld, %d bytes): LZW %d bytes, %.2f MB/s, %d resets || LZWd %d bytes, %.2f MB/s, %d resets\n",
+               block_count, src_size, (int)nbytes, jobs[0].bytes, throughput(nbytes, jobs[0].seconds), jobs[0].resets,
+               jobs[1].bytes, throughput(nbytes, jobs[1].seconds), jobs[1].resets);
+        if (csv_file) {
+            fprintf(csv_file, "%lld,%d", src_size, (int)nbytes);
+            for (int a = 0; a < 2; a++) {
+                fprintf(csv_file, ",%d,%.4f,%.2f,%d", jobs[a].bytes, ratio(jobs[a].bytes, nbytes),
+                        throughput(nbytes, jobs[a].seconds), jobs[a].resets);
+            }
+            fprintf(csv_file, "\n");
+        }
+        src_size += nbytes;
+    }
+
+    // Z. Program Output
+    printf("Source: %s with %lld bytes || Blocks processed: %d || Block size: %d\n", argv[optind], src_size, block_count, block_size);
+    print_totals("LZW", &totals[0], src_size);
+    print_totals("LZWd", &totals[1], src_size);
+    t_end = clock() - t_start;
+    printf("Duration(TOTAL): %f seconds\n", ((double)t_end) / CLOCKS_PER_SEC);
+
+    // memory cleanup
+    free(buffer_in);
+    free(jobs[0].buffer_out);
+    free(jobs[1].buffer_out);
+    fclose(src_file);
+    if (csv_file)
+        fclose(csv_file);
+}
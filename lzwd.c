@@ -4,22 +4,29 @@
  * project: File compression (LZWd algorithm)
  **/
 
-#include "lzwd_lib.h"
+#include "lzwd_compress.h"
 
 int debugflag = 0; // if true use debug moode
 int sizeflag = 0;  // if true use costum block size
 int textflag = 0;  // if true present inputs and outputs
+int parse_level = 0; // 0 for greedy parsing, higher levels look further ahead
+int dict_size = DICT_SIZE; // dictionary entries before it is cleared, set for every file
+int dict_key_max = 0;      // bytes of patterns a dictionary keeps, set by -M
+int pattern_max = 0;       // longest pattern a dictionary keeps, set by -M
+long long memory_limit = 0; // most bytes of memory to use, 0 for no limit
+int entropyflag = 0; // if true huffman code the output indexes
+int dedupflag = 0;   // if true write repeated blocks as a reference to the first one
+int mode = 0;        // COMPRESS_APPEND and/or COMPRESS_RESUME to add to existing compressed files
 
 int main(int argc, char *argv[]) {
 
     clock_t t_start = clock(), t_end; // clocks for executing time calculations
-    FILE *src_file, *dest_file;
     int block_size = 0;
-    int src_size = 0, dest_size = 0, block_count = 0, last_block_size = 0; // output auxiliars
+    char *output_name = NULL; // compressed file of every source, set by -o
 
     // 1. read and interpret the input
     int opt;
-    while ((opt = getopt(argc, argv, "dtls:")) != -1) {
+    while ((opt = getopt(argc, argv, "dteDarl:s:M:o:")) != -1) {
         switch (opt) {
         case 'd':
             debugflag = 1;
@@ -29,9 +36,54 @@ int main(int argc, char *argv[]) {
             textflag = 1;
             printf(DEBUG_TXT "Program iniciated in text mode.\n" RESET_TXT);
             break;
+        case 'e':
+            entropyflag = 1;
+            printf(DEBUG_TXT "Using entropy coding of output indexes.\n" RESET_TXT);
+            break;
+        case 'D':
+            dedupflag = 1;
+            printf(DEBUG_TXT "Using deduplication of repeated blocks.\n" RESET_TXT);
+            break;
+        case 'M':
+            memory_limit = parse_memory(optarg);
+            if (memory_limit <= 0) {
+                printf("Invalid memory limit.\n%s\n", USAGE_MSG);
+                return 1;
+            }
+            printf(DEBUG_TXT "Using at most %lld bytes of memory.\n" RESET_TXT, memory_limit);
+            break;
+        case 'a':
+            mode |= COMPRESS_APPEND;
+            printf(DEBUG_TXT "Appending to existing compressed files.\n" RESET_TXT);
+            break;
+        case 'r':
+            mode |= COMPRESS_RESUME;
+            printf(DEBUG_TXT "Resuming interrupted compression.\n" RESET_TXT);
+            break;
+        case 'o':
+            output_name = optarg;
+            printf(DEBUG_TXT "Compressing every file into %s.\n" RESET_TXT, output_name);
+            break;
+        case 'l':
+            parse_level = atoi(optarg);
+            if (parse_level < 0 || parse_level > PARSE_LEVEL_MAX) {
+                printf("Invalid parsing level.\n%s\n", USAGE_MSG);
+                return 1;
+            }
+            printf(DEBUG_TXT "Using parsing level %d.\n" RESET_TXT, parse_level);
+            break;
         case 's':
             sizeflag = 1;
+            if (strcmp(optarg, "auto") == 0) {
+                block_size = BLOCK_SIZE_AUTO;
+                printf(DEBUG_TXT "Picking block size from samples of every file.\n" RESET_TXT);
+                break;
+            }
             block_size = atoi(optarg);
+            if (block_size < 1) {
+                printf("Invalid block size.\n%s\n", USAGE_MSG);
+                return 1;
+            }
             printf(DEBUG_TXT "Using costum block size of %d.\n" RESET_TXT, block_size);
             break;
         case '?':
@@ -42,101 +94,59 @@ int main(int argc, char *argv[]) {
         }
     }
     // faulty input check
-    int maxarguments = 0, idx_arg = 0;
-    for (idx_arg = optind; idx_arg < argc; idx_arg++) {
-        maxarguments++;
-        if (maxarguments > 1) {
-            printf("%s", "Too many arguments.");
-            return 1;
-        }
-    }
-
-    // 2.OPEN SOURCE file
-    src_file = fopen(argv[optind], "r");
-    if (!src_file) {
-        printf("Unable to open supplied file.\n");
+    if (optind >= argc) {
+        printf("%s\n", USAGE_MSG);
         return 1;
     }
-    // extract filename from source to name the output file
-    char *src_name = malloc(strlen(argv[optind]));
-    strcpy(src_name, argv[optind]);
-    char *filename = strtok(argv[optind], ".");
 
-    // 3. CREATE AND OPEN destination file with ".lzwd" extension
-    int namesize = strlen(filename);
-    char *compress_name = malloc(namesize + 6);
-    strcpy(compress_name, filename);
-    strcat(compress_name, ".lzwd");
-    dest_file = fopen(compress_name, "w");
-    if (!dest_file) {
-        printf("Unable to create destination file.\n");
-        return 1;
-    }
-
-    // 4. Block Read
+    // 4. Block size
     if (!sizeflag) {
         block_size = BLOCK_SIZE_DEFAULT;
     }
-    size_t nbytes = 0; // quantity of bytes read in block
-    int *buffer_in = malloc(sizeof(int) * block_size);
-    int *buffer_out = malloc(sizeof(int) * block_size);
-    int output_size = 0;
-
-    // 5. loop blocks of bytes until EOF 'aka' reading a block of 0 bytes
-    while ((nbytes = fread(buffer_in, 1, block_size, src_file)) > 0) {
-
-        block_count++;
-        if (debugflag) {
-            printf("processing block %d. Input:\n", block_count);
-            for (int b = 0; b < nbytes; b++) {
-                printf("%d ", ((unsigned char *)buffer_in)[b]);
-            }
-            printf("\n");
-        }
-        // 5.1 process block
-        output_size = lzwd_encode(buffer_in, nbytes, buffer_out);
-
-        // 5.2 save size of last block and total sizes
-        src_size += nbytes;
-        dest_size += output_size;
-        last_block_size = nbytes;
-
-        // 5.3 write encoded block to output file
-        short *short_buffer_out = malloc(sizeof(short) * output_size);
-        for (int i = 0; i < output_size; i++) {
-            short_buffer_out[i] = buffer_out[i];
-        }
-
-        fwrite(short_buffer_out, 1, sizeof(short) * output_size, dest_file);
-
-        free(short_buffer_out);
-
-        if (textflag || debugflag) {
-            printf("Output block %d: \n", block_count);
-            for (int b = 0; b < output_size; b++) {
-                printf("%d ", buffer_out[b]);
-            }
-            printf("\n");
-        }
+    // adding several files to one compressed file is fine, creating it twice isn't
+    if (!output_name && !(mode & COMPRESS_APPEND) && check_compressed_names(argv + optind, argc - optind, ".lzwd") != 0)
+        return 1;
+    if (output_name && (mode & COMPRESS_RESUME) && argc - optind > 1) {
+        printf("Only one file can be resumed into %s.\n", output_name);
+        return 1;
     }
+    dedup_table *dedup = dedupflag ? create_dedup() : NULL;
 
     // Z. Program Output
     printf("Author: Tiago & Joana\n");
     time_t now;
     time(&now); // get current date and time
     printf("Time of execution: %s", ctime(&now));
-    printf("Source: %s with %d bytes\nCompressed: %s with %d bytes\n", src_name, src_size, compress_name, dest_size);
-    float compression = (1 - (float)dest_size / src_size) * 100;
-    printf("Total compresion: %.2f %%\n", compression);
-    printf("Blocks processed: %d || Block size: %d || Last Block: %d\n", block_count, block_size, last_block_size);
+
+    // 2. to 6. compress every file given, repeated blocks may reference blocks of the previous ones
+    for (int idx_arg = optind; idx_arg < argc; idx_arg++) {
+        char *compress_name = output_name ? strdup(output_name) : compressed_name(argv[idx_arg], ".lzwd");
+        // with -o, files after the first are added to the compressed file of the first
+        int file_mode = output_name && idx_arg > optind ? COMPRESS_APPEND : mode;
+        compress_stats stats;
+        if (compress_file(argv[idx_arg], compress_name, ALGO_LZWD, block_size, dedup, file_mode, &stats) != 0) {
+            free(compress_name);
+            return 1;
+        }
+
+        if (stats.resume_offset)
+            printf("Resumed at source byte %lld\n", stats.resume_offset);
+        printf("Source: %s with %d bytes\nCompressed: %s with %d bytes (%d indexes)\n", argv[idx_arg], stats.src_size, compress_name, stats.dest_bytes, stats.dest_size);
+        float compression = (1 - (float)stats.dest_bytes / stats.src_size) * 100;
+        printf("Total compresion: %.2f %%\n", compression);
+        printf("Blocks processed: %d || Block size: %d || Last Block: %d\n", stats.block_count, stats.block_size, stats.last_block_size);
+        if (sizeflag && block_size == BLOCK_SIZE_AUTO)
+            printf("Block size picked: %d || Dictionary size picked: %d\n", stats.block_size, stats.dict_size);
+        if (dedupflag)
+            printf("Repeated blocks: %d\n", stats.dedup_count);
+        if (memory_limit)
+            printf("Memory: %lld of %lld bytes || Longest pattern kept: %d\n", stats.memory, memory_limit, pattern_max);
+        free(compress_name);
+    }
     t_end = clock() - t_start;
     printf("Duration(TOTAL): %f seconds\n", ((double)t_end) / CLOCKS_PER_SEC);
 
     // memory cleanup
-    free(buffer_in);
-    free(buffer_out);
-    free(compress_name);
-    free(src_name);
-    fclose(src_file);
-    fclose(dest_file);
+    if (dedup)
+        dedup_free(dedup);
 }
@@ -0,0 +1,543 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#include "lzwd_compress.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+
+/**
+ * Names the compressed file after the source one: everything before the first '.' of its file name
+ * plus extension, in the same directory.
+ * @param src_path name of source file
+ * @param extension extension of compressed file, with the '.'
+ *
+ * @return newly allocated name
+ **/
+char *compressed_name(char *src_path, char *extension) {
+    char *filename = strrchr(src_path, '/');
+    filename = filename ? filename + 1 : src_path;
+    char *dot = filename[0] ? strchr(filename + 1, '.') : NULL; // a leading '.' is part of the name
+    int name_size = dot ? dot - src_path : strlen(src_path);
+
+    char *compress_name = malloc(name_size + strlen(extension) + 1);
+    memcpy(compress_name, src_path, name_size);
+    strcpy(compress_name + name_size, extension);
+    return compress_name;
+}
+
+/**
+ * Checks that no two sources of a batch are compressed to the same file: the second would replace
+ * the first, and the references other files make to its blocks.
+ * @param src_paths names of source files
+ * @param count number of source files
+ * @param extension extension of compressed files, with the '.'
+ *
+ * @return 0 if ok, 1 if two names are the same (already reported)
+ **/
+int check_compressed_names(char **src_paths, int count, char *extension) {
+    int status = 0;
+    for (int i = 1; i < count && !status; i++) {
+        char *name = compressed_name(src_paths[i], extension);
+        for (int j = 0; j < i && !status; j++) {
+            char *other = compressed_name(src_paths[j], extension);
+            if (strcmp(name, other) == 0) {
+                printf("%s and %s would both be compressed to %s.\n", src_paths[j], src_paths[i], name);
+                status = 1;
+            }
+            free(other);
+        }
+        free(name);
+    }
+    return status;
+}
+
+/**
+ * Memory taken by the buffers of one block while compressing it.
+ * @param block_size reading block size
+ *
+ * @return bytes
+ **/
+long long block_memory(int block_size) {
+    // source bytes, indexes as int, then the encoded block
+    return block_size + sizeof(int) + (long long)sizeof(int) * block_size + BLOCK_HEADER_SIZE + 2LL * block_size + 1;
+}
+
+/**
+ * Memory taken by compress_file at most, with the limits currently set (dictionary patterns and
+ * table of repeated blocks).
+ * @param block_size reading block size
+ * @param dedup table of repeated blocks (NULL if not used)
+ *
+ * @return bytes
+ **/
+long long compress_memory(int block_size, dedup_table *dedup) {
+    long long memory = MEMORY_FIXED + block_memory(block_size) + dict_memory();
+    memory += (long long)PATTERN_BUFFERS * sizeof(int) * (pattern_max + 1);
+    if (dedup)
+        memory += dedup_memory(dedup->max_capacity);
+    return memory;
+}
+
+/**
+ * Sizes the table of repeated blocks, the patterns kept by the dictionary and the blocks so
+ * compress_file takes at most limit bytes. The table gets 1/MEMORY_DEDUP_SHARE of the memory,
+ * the dictionary 1/MEMORY_DICT_SHARE of what is left and blocks the rest.
+ * @param limit most bytes to use
+ * @param dedup table of repeated blocks (NULL if not used)
+ * @param block_size reading block size, made smaller if it doesn't fit
+ *
+ * @return 0 if ok, -1 if limit is too low
+ **/
+int fit_memory(long long limit, dedup_table *dedup, int *block_size) {
+    dict_key_max = 0;
+    long long rest = limit - MEMORY_FIXED - dict_memory();
+
+    // 1. table of repeated blocks
+    if (dedup) {
+        int capacity = dedup->capacity;
+        while (capacity < INT_MAX / 2 && dedup_memory(2 * capacity) <= rest / MEMORY_DEDUP_SHARE) {
+            capacity *= 2;
+        }
+        dedup->max_capacity = capacity;
+        rest -= dedup_memory(capacity);
+    }
+
+    // 2. dictionary, half for patterns kept and half for the pattern buffers of the encoders
+    long long share = rest / MEMORY_DICT_SHARE;
+    if (share > MEMORY_DICT_MAX)
+        share = MEMORY_DICT_MAX;
+    dict_key_max = share / 2;
+    pattern_max = share / 2 / (PATTERN_BUFFERS * sizeof(int)) - 1;
+    rest -= dict_key_max + (long long)PATTERN_BUFFERS * sizeof(int) * (pattern_max + 1);
+    if (dict_key_max < MEMORY_KEYS_MIN || pattern_max < 2)
+        return -1;
+
+    // 3. blocks
+    long long largest = (rest - block_memory(0)) / (block_memory(1) - block_memory(0));
+    if (largest < MEMORY_BLOCK_MIN)
+        return -1;
+    if (*block_size > largest)
+        *block_size = largest;
+    return 0;
+}
+
+/**
+ * Reads a memory size, in bytes or with a K, M or G suffix.
+ * @param text size to read
+ *
+ * @return bytes, -1 if not valid
+ **/
+long long parse_memory(char *text) {
+    char *end;
+    errno = 0;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value <= 0 || errno == ERANGE)
+        return -1;
+    int shift = 0;
+    switch (*end) {
+    case 'G':
+    case 'g':
+        shift += 10;
+        // fall through
+    case 'M':
+    case 'm':
+        shift += 10;
+        // fall through
+    case 'K':
+    case 'k':
+        shift += 10;
+        end++;
+    }
+    // bytes must fit in a size_t (and a long long)
+    unsigned long long max = SIZE_MAX < LLONG_MAX ? SIZE_MAX : LLONG_MAX;
+    if (*end || (unsigned long long)value > max >> shift)
+        return -1;
+    return value << shift;
+}
+
+/**
+ * Trial compresses one block of the given size in every sampled region of a file, with the
+ * dictionary size currently set.
+ * @param src_file file to sample
+ * @param file_size size of file
+ * @param algorithm ALGO_LZW or ALGO_LZWD
+ * @param block_size size of the blocks to try
+ * @param buffer_in buffer for block_size source bytes
+ * @param buffer_out buffer for block_size indexes
+ * @param result where to save the totals of the trial
+ **/
+static void trial_compress(FILE *src_file, long long file_size, int algorithm, int block_size, int *buffer_in, int *buffer_out, tune_trial *result) {
+    memset(result, 0, sizeof(tune_trial));
+    for (int i = 0; i < AUTO_SAMPLES; i++) {
+        // block centered in its region, regions spread evenly over the file
+        long long offset = file_size * (2 * i + 1) / (2 * AUTO_SAMPLES) - block_size / 2;
+        if (offset > file_size - block_size)
+            offset = file_size - block_size;
+        if (offset < 0)
+            offset = 0;
+        fseek(src_file, offset, SEEK_SET);
+        int nbytes = fread(buffer_in, 1, block_size, src_file);
+        if (nbytes <= 0)
+            break;
+
+        clock_t start = clock();
+        int output_size;
+        if (algorithm == ALGO_LZW)
+            output_size = lzw_encode(buffer_in, nbytes, buffer_out, NULL);
+        else
+            output_size = lzwd_encode(buffer_in, nbytes, buffer_out, NULL);
+        result->seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+        result->src_size += nbytes;
+        result->bytes += encoded_block_size(buffer_out, output_size);
+        result->blocks++;
+
+        // whole file in one block, the other regions are the same
+        if (nbytes >= file_size)
+            break;
+    }
+}
+
+/**
+ * Score of a trial, throughput times compression ratio.
+ **/
+static double trial_score(tune_trial *trial) {
+    double seconds = trial->seconds > 1e-6 ? trial->seconds : 1e-6;
+    return (trial->src_size / seconds) * ((double)trial->src_size / trial->bytes);
+}
+
+/**
+ * Source bytes encoded by a trial of a block size.
+ **/
+static long long trial_cost(int block_size, long long file_size) {
+    return block_size < file_size ? (long long)block_size * AUTO_SAMPLES : file_size;
+}
+
+/**
+ * Picks the trial with the best score among the ones compressing at most AUTO_RATIO_LOSS worse
+ * than the best one, so speed never buys a much bigger file.
+ * @param trials trials to pick from
+ * @param count number of trials (at least 1)
+ *
+ * @return index of trial picked
+ **/
+static int pick_trial(tune_trial *trials, int count) {
+    double best_ratio = 0;
+    for (int i = 0; i < count; i++) {
+        double ratio = (double)trials[i].bytes / trials[i].src_size;
+        if (i == 0 || ratio < best_ratio)
+            best_ratio = ratio;
+    }
+    int best = -1;
+    for (int i = 0; i < count; i++) {
+        double ratio = (double)trials[i].bytes / trials[i].src_size;
+        if (ratio <= best_ratio * (1 + AUTO_RATIO_LOSS) && (best == -1 || trial_score(&trials[i]) > trial_score(&trials[best])))
+            best = i;
+    }
+    return best;
+}
+
+/**
+ * Picks the block size and dictionary size for a file (-s auto). Candidate dictionary sizes are tried
+ * first on the smallest blocks (the default one first), then candidate block sizes with the best
+ * dictionary, as long as a block takes at most AUTO_LATENCY_MAX seconds and the memory allowed.
+ * All trials together encode at most 1/AUTO_SAMPLE_SHARE of the file, files too small for one keep
+ * the smallest block and the default dictionary.
+ * @param src_file file to compress, left at its start
+ * @param algorithm ALGO_LZW or ALGO_LZWD
+ * @param largest biggest block size allowed
+ * @param block_size where to save the block size picked
+ * @param best_dict where to save the dictionary size picked
+ **/
+void tune_block_size(FILE *src_file, int algorithm, int largest, int *block_size, int *best_dict) {
+    fseek(src_file, 0, SEEK_END);
+    long long file_size = ftell(src_file);
+    long long budget = file_size / AUTO_SAMPLE_SHARE, spent = 0;
+    int max_size = BLOCK_SIZE_MIN << (AUTO_SIZES - 1);
+    if (max_size > largest)
+        max_size = largest;
+    int *buffer_in = malloc(max_size + sizeof(int));
+    int *buffer_out = malloc(sizeof(int) * max_size);
+    tune_trial trials[AUTO_SIZES + 16]; // dictionary sizes, then block sizes
+    int sizes[AUTO_SIZES + 16];         // dictionary or block size of every trial
+    int ntrials = 0;
+
+    *block_size = BLOCK_SIZE_MIN < max_size ? BLOCK_SIZE_MIN : max_size;
+    *best_dict = DICT_SIZE;
+
+    // 1. dictionary sizes on the smallest blocks
+    for (dict_size = DICT_SIZE; dict_size >= DICT_SIZE_MIN && file_size > 0; dict_size /= 2) {
+        if (spent + trial_cost(*block_size, file_size) > budget)
+            break;
+        trial_compress(src_file, file_size, algorithm, *block_size, buffer_in, buffer_out, &trials[ntrials]);
+        spent += trials[ntrials].src_size;
+        if (debugflag)
+            printf(DEBUG_TXT "Trial block size %d, dictionary %d: %lld -> %lld bytes in %f seconds.\n" RESET_TXT,
+                   *block_size, dict_size, trials[ntrials].src_size, trials[ntrials].bytes, trials[ntrials].seconds);
+        sizes[ntrials++] = dict_size;
+    }
+    if (ntrials > 0) {
+        int best = pick_trial(trials, ntrials);
+        *best_dict = sizes[best];
+        trials[0] = trials[best];
+        sizes[0] = *block_size;
+        ntrials = 1;
+    }
+
+    // 2. bigger blocks, until they take too long, too much memory or the file is in one block
+    dict_size = *best_dict;
+    for (int size = 2 * BLOCK_SIZE_MIN; ntrials > 0 && size <= max_size && size / 2 < file_size; size *= 2) {
+        if (spent + trial_cost(size, file_size) > budget)
+            break;
+        tune_trial *trial = &trials[ntrials];
+        trial_compress(src_file, file_size, algorithm, size, buffer_in, buffer_out, trial);
+        spent += trial->src_size;
+        if (debugflag)
+            printf(DEBUG_TXT "Trial block size %d, dictionary %d: %lld -> %lld bytes in %f seconds.\n" RESET_TXT,
+                   size, dict_size, trial->src_size, trial->bytes, trial->seconds);
+        if (trial->seconds / trial->blocks > AUTO_LATENCY_MAX)
+            break;
+        sizes[ntrials++] = size;
+    }
+    if (ntrials > 0)
+        *block_size = sizes[pick_trial(trials, ntrials)];
+
+    fseek(src_file, 0, SEEK_SET);
+    free(buffer_in);
+    free(buffer_out);
+}
+
+/**
+ * Opens the compressed file of an append or resume job and puts it right after its last block.
+ * Anything after that block (parts of an interrupted job) is cut off.
+ * @param compress_name name of compressed file
+ * @param algorithm algorithm of the job, must be the one of the file
+ * @param mode COMPRESS_APPEND and/or COMPRESS_RESUME
+ * @param header where to save the header of the file
+ * @param src_offset where to save the source bytes of the job already in the file
+ *
+ * @return opened file, NULL on error (already reported)
+ **/
+static FILE *open_existing(char *compress_name, int algorithm, int mode, file_header *header, long long *src_offset) {
+    FILE *dest_file = fopen(compress_name, "r+b");
+    if (!dest_file) {
+        printf("Unable to open destination file.\n");
+        return NULL;
+    }
+    if (read_file_header(dest_file, header) != 0 || header->algorithm != algorithm) {
+        printf("%s is not a file of this algorithm.\n", compress_name);
+        fclose(dest_file);
+        return NULL;
+    }
+
+    // blocks counted in the header are complete, an append job goes after them
+    int block_count = 0;
+    long long src_size = 0;
+    long end = scan_blocks(dest_file, (mode & COMPRESS_APPEND) ? header->block_count : 0, 0, &block_count, &src_size);
+    if (block_count != ((mode & COMPRESS_APPEND) ? header->block_count : 0)) {
+        printf("%s is missing blocks.\n", compress_name);
+        fclose(dest_file);
+        return NULL;
+    }
+
+    // blocks of the interrupted job are kept up to the first one not fully written
+    *src_offset = 0;
+    if (mode & COMPRESS_RESUME) {
+        long long committed = src_size;
+        end = scan_blocks(dest_file, -1, 1, &block_count, &src_size);
+        *src_offset = src_size - committed;
+    }
+    if (fflush(dest_file) != 0 || ftruncate(fileno(dest_file), end) != 0) {
+        printf("Unable to write to destination file.\n");
+        fclose(dest_file);
+        return NULL;
+    }
+    header->block_count = block_count;
+    header->src_size = src_size;
+    return dest_file;
+}
+
+/**
+ * Compresses a file block by block into a compressed file.
+ * @param src_path name of file to compress
+ * @param compress_name name of compressed file to create, or to add to
+ * @param algorithm ALGO_LZW or ALGO_LZWD
+ * @param block_size reading block size, BLOCK_SIZE_AUTO to pick it (and the dictionary size) from samples
+ * @param dedup blocks already compressed, to write repeated blocks as references (NULL to disable)
+ * @param mode 0 for a new file, COMPRESS_APPEND to add the blocks to an existing one, COMPRESS_RESUME to
+ * carry on an interrupted job from the last complete block, or start a new file if there is none (both to
+ * carry on an interrupted append)
+ * @param stats where to save the totals of the blocks written by this job
+ *
+ * @return 0 if ok, 1 on error (already reported)
+ **/
+int compress_file(char *src_path, char *compress_name, int algorithm, int block_size, dedup_table *dedup, int mode, compress_stats *stats) {
+    FILE *src_file, *dest_file;
+    file_header header = {algorithm, parse_level, block_size, 0, 0, DICT_SIZE};
+    long long src_offset = 0;
+    memset(stats, 0, sizeof(compress_stats));
+
+    // 2.OPEN SOURCE file
+    src_file = fopen(src_path, "rb");
+    if (!src_file) {
+        printf("Unable to open supplied file.\n");
+        return 1;
+    }
+
+    // 3. CREATE AND OPEN destination file, or open the one to carry on (nothing to resume: a new one)
+    if (mode == COMPRESS_RESUME && access(compress_name, F_OK) != 0)
+        mode = 0;
+    if (mode) {
+        dest_file = open_existing(compress_name, algorithm, mode, &header, &src_offset);
+        int largest = INT_MAX;
+        if (dest_file && memory_limit && fit_memory(memory_limit, dedup, &largest) != 0)
+            largest = 0;
+        if (dest_file && largest < header.block_size) {
+            printf("Memory limit too low for the block size of %s (%d).\n", compress_name, header.block_size);
+            fclose(dest_file);
+            dest_file = NULL;
+        }
+        // the block size asked for, lowered by -M as it was when the file was created
+        int asked = block_size < largest ? block_size : largest;
+        if (dest_file && sizeflag && block_size != BLOCK_SIZE_AUTO && asked != header.block_size) {
+            printf("%s uses a block size of %d.\n", compress_name, header.block_size);
+            fclose(dest_file);
+            dest_file = NULL;
+        }
+        if (dest_file && fseek(src_file, src_offset, SEEK_SET) != 0) {
+            printf("Unable to read supplied file.\n");
+            fclose(dest_file);
+            dest_file = NULL;
+        }
+        block_size = header.block_size;
+    } else {
+        // without a limit, -s auto keeps the buffers of a block under AUTO_MEMORY_MAX as it always counted them
+        int largest = block_size != BLOCK_SIZE_AUTO ? block_size : AUTO_BLOCK_MAX;
+        if (memory_limit && fit_memory(memory_limit, dedup, &largest) != 0) {
+            printf("Memory limit too low.\n");
+            fclose(src_file);
+            return 1;
+        }
+        if (block_size == BLOCK_SIZE_AUTO) {
+            tune_block_size(src_file, algorithm, largest, &block_size, &header.dict_size);
+        } else if (largest < block_size) {
+            printf(DEBUG_TXT "Block size lowered to %d to fit the memory limit.\n" RESET_TXT, largest);
+            block_size = largest;
+        }
+        header.block_size = block_size;
+        if (dedup)
+            dedup_drop_file(dedup, compress_name);
+        dest_file = fopen(compress_name, "wb");
+        if (!dest_file)
+            printf("Unable to create destination file.\n");
+    }
+    if (!dest_file) {
+        fclose(src_file);
+        return 1;
+    }
+    int first_block = header.block_count; // index of first block written by this job
+    dict_size = header.dict_size;
+    stats->block_size = block_size;
+    stats->dict_size = dict_size;
+    stats->resume_offset = src_offset;
+    if (memory_limit)
+        stats->memory = compress_memory(block_size, dedup);
+
+    // 4. Block Read
+    size_t nbytes = 0; // quantity of bytes read in block
+    int *buffer_in = malloc(block_size + sizeof(int)); // source bytes, int only for the encoders
+    int *buffer_out = malloc(sizeof(int) * block_size);
+    int output_size = 0;
+    int status = 0;
+
+    // header is written again with the totals once all blocks are done
+    if (!mode) {
+        if (write_file_header(dest_file, &header) != 0)
+            status = 1;
+        stats->dest_bytes = FILE_HEADER_SIZE;
+    }
+    if (dedup)
+        dedup_start_file(dedup, compress_name);
+
+    // 5. loop blocks of bytes until EOF 'aka' reading a block of 0 bytes
+    while (!status && (nbytes = fread(buffer_in, 1, block_size, src_file)) > 0) {
+
+        stats->block_count++;
+        if (debugflag) {
+            printf("processing block %d. Input:\n", stats->block_count);
+            for (int b = 0; b < nbytes; b++) {
+                printf("%d ", ((unsigned char *)buffer_in)[b]);
+            }
+            printf("\n");
+        }
+        stats->src_size += nbytes;
+        stats->last_block_size = nbytes;
+
+        // 5.1 repeated block: write a reference to the first one instead
+        unsigned long long hash[2] = {0, 0};
+        dedup_entry *found = NULL;
+        if (dedup) {
+            block_hash((byte *)buffer_in, nbytes, hash);
+            found = dedup_find(dedup, hash, nbytes);
+        }
+        block_ref ref = {{hash[0], hash[1]}, 0, ""};
+        int other = found && found->file != dedup->nfiles - 1 && strcmp(dedup->files[found->file], compress_name) != 0;
+        if (other && ref_archive_name(compress_name, dedup->files[found->file], ref.archive) != 0)
+            found = NULL; // archive can't be named, encode the block
+        if (found) {
+            ref.block = found->block;
+            int written = write_ref_block(dest_file, &ref, nbytes);
+            if (written < 0)
+                status = 1;
+            stats->dest_bytes += written;
+            stats->dedup_count++;
+            if (debugflag)
+                printf(DEBUG_TXT "Block %d repeats block %d of %s.\n" RESET_TXT, first_block + stats->block_count, found->block + 1,
+                       dedup->files[found->file]);
+            continue;
+        }
+
+        // 5.2 process block
+        if (algorithm == ALGO_LZW)
+            output_size = lzw_encode(buffer_in, nbytes, buffer_out, NULL);
+        else
+            output_size = lzwd_encode(buffer_in, nbytes, buffer_out, NULL);
+        stats->dest_size += output_size;
+
+        // 5.3 write encoded block to output file
+        int written = write_block(dest_file, buffer_out, output_size, nbytes);
+        if (written < 0)
+            status = 1;
+        stats->dest_bytes += written;
+        if (dedup)
+            dedup_add(dedup, hash, nbytes, first_block + stats->block_count - 1);
+
+        if (textflag || debugflag) {
+            printf("Output block %d: \n", stats->block_count);
+            for (int b = 0; b < output_size; b++) {
+                printf("%d ", buffer_out[b]);
+            }
+            printf("\n");
+        }
+    }
+
+    // 6. save totals in header, only once the blocks are stored so the file is never counting blocks it lacks
+    header.block_count = first_block + stats->block_count;
+    header.src_size += stats->src_size;
+    if (status || commit_file_header(dest_file, &header) != 0) {
+        printf("Unable to write to destination file.\n");
+        status = 1;
+    }
+    if (dedup)
+        dedup_end_file(dedup);
+
+    // memory cleanup
+    free(buffer_in);
+    free(buffer_out);
+    fclose(src_file);
+    fclose(dest_file);
+    return status;
+}
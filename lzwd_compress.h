@@ -0,0 +1,65 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#ifndef LZWD_COMPRESS
+#define LZWD_COMPRESS
+
+#include "lzwd_dedup.h"
+#include "lzwd_file.h"
+
+extern long long memory_limit;
+
+// DEFINES
+#define COMPRESS_APPEND 1 // add blocks to an existing compressed file
+#define COMPRESS_RESUME 2 // carry on an interrupted job from its last complete block
+#define BLOCK_SIZE_AUTO 0 // block size of -s auto
+#define AUTO_SIZES 5      // candidate block sizes, BLOCK_SIZE_MIN times powers of 2
+#define AUTO_SAMPLES 3    // regions of the file trial compressed
+#define AUTO_SAMPLE_SHARE 4       // trials of block sizes encode at most 1/AUTO_SAMPLE_SHARE of the file
+#define AUTO_LATENCY_MAX 0.25     // most seconds to encode a block
+#define AUTO_RATIO_LOSS 0.02      // -s auto never picks sizes compressing more than 2 % worse than the best tried
+#define AUTO_MEMORY_MAX (8 << 20) // most bytes taken by the buffers of a block, when there is no memory limit
+#define AUTO_BLOCK_MAX ((AUTO_MEMORY_MAX - BLOCK_HEADER_SIZE) / (2 * (int)sizeof(int) + 2)) // counting source and indexes as int
+#define MEMORY_FIXED (256 << 10)  // file buffers, huffman tables and other memory not depending on sizes
+#define MEMORY_DEDUP_SHARE 8      // share of the memory limit for the table of repeated blocks
+#define MEMORY_DICT_SHARE 4       // share of the rest for the dictionary patterns
+#define MEMORY_DICT_MAX (4 << 20) // most memory for the dictionary patterns, longer ones aren't worth it
+#define MEMORY_KEYS_MIN (2 * DICT_SIZE) // fewest bytes of patterns kept by a dictionary
+#define MEMORY_BLOCK_MIN 4096     // smallest block size to fit in the memory limit
+#define PATTERN_BUFFERS 7 // most pattern_max sized int buffers an encoder holds at once, while growing one
+
+// resultado da compressao de um ficheiro
+typedef struct compress_stats {
+    int src_size;        // source bytes
+    int dest_size;       // indexes written
+    int dest_bytes;      // bytes written
+    int block_count;     // blocks processed
+    int last_block_size; // source bytes in last block
+    int dedup_count;     // blocks written as a reference to an equal block
+    int block_size;      // block size used, the one of the compressed file when adding to it
+    long long resume_offset; // source bytes already compressed by the interrupted job
+    int dict_size;       // dictionary entries before it is cleared
+    long long memory;    // most memory used, when there is a limit
+} compress_stats;
+
+// resultado de uma compressao de teste
+typedef struct tune_trial {
+    long long src_size; // source bytes encoded
+    long long bytes;    // size of the encoded blocks
+    int blocks;
+    double seconds;
+} tune_trial;
+
+char *compressed_name(char *src_path, char *extension);
+int check_compressed_names(char **src_paths, int count, char *extension);
+long long block_memory(int block_size);
+long long compress_memory(int block_size, dedup_table *dedup);
+int fit_memory(long long limit, dedup_table *dedup, int *block_size);
+long long parse_memory(char *text);
+void tune_block_size(FILE *src_file, int algorithm, int largest, int *block_size, int *best_dict);
+int compress_file(char *src_path, char *compress_name, int algorithm, int block_size, dedup_table *dedup, int mode, compress_stats *stats);
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#include "lzwd_dedup.h"
+
+static unsigned long long rotl64(unsigned long long x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static unsigned long long fmix64(unsigned long long k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static unsigned long long read_u64(byte *data) {
+    unsigned long long value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+/**
+ * 128 bit hash of a block (MurmurHash3 x64 128, seed 0).
+ * @param data bytes to hash
+ * @param size number of bytes
+ * @param hash where to save the 2 halves of the hash
+ **/
+void block_hash(byte *data, int size, unsigned long long *hash) {
+    const unsigned long long c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+    unsigned long long h1 = 0, h2 = 0;
+    int nblocks = size / 16;
+
+    for (int i = 0; i < nblocks; i++) {
+        unsigned long long k1 = read_u64(data + 16 * i);
+        unsigned long long k2 = read_u64(data + 16 * i + 8);
+
+        k1 *= c1;
+        k1 = rotl64(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+        h1 = rotl64(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2;
+        k2 = rotl64(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+        h2 = rotl64(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // last 0 to 15 bytes
+    byte *tail = data + 16 * nblocks;
+    unsigned long long k1 = 0, k2 = 0;
+    for (int i = (size & 15) - 1; i >= 8; i--) {
+        k2 = (k2 << 8) | tail[i];
+    }
+    for (int i = ((size & 15) < 8 ? (size & 15) : 8) - 1; i >= 0; i--) {
+        k1 = (k1 << 8) | tail[i];
+    }
+    if (size & 15) {
+        k2 *= c2;
+        k2 = rotl64(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+        k1 *= c1;
+        k1 = rotl64(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+    }
+
+    h1 ^= size;
+    h2 ^= size;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+
+    hash[0] = h1;
+    hash[1] = h2;
+}
+
+/**
+ * Creates new empty table of compressed blocks.
+ *
+ * @return Pointer to newly created table.
+ **/
+dedup_table *create_dedup() {
+    dedup_table *table = malloc(sizeof(dedup_table));
+    table->capacity = 1024;
+    table->max_capacity = 0;
+    table->count = 0;
+    table->entries = calloc(table->capacity, sizeof(dedup_entry));
+    table->files = NULL;
+    table->nfiles = 0;
+    return table;
+}
+
+/**
+ * Puts an entry in the first free slot of its chain. Slots with raw_size 0 are free.
+ **/
+static void dedup_insert(dedup_table *table, dedup_entry *entry) {
+    int slot = entry->hash[0] & (table->capacity - 1);
+    while (table->entries[slot].raw_size != 0) {
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    table->entries[slot] = *entry;
+    table->count++;
+}
+
+/**
+ * Rebuilds the table with the given capacity, keeping only entries of the file being written and
+ * the sampled ones of previous files. Dropped entries are left out.
+ **/
+static void dedup_rebuild(dedup_table *table, int capacity, int sample) {
+    dedup_entry *old = table->entries;
+    int old_capacity = table->capacity;
+
+    table->entries = calloc(capacity, sizeof(dedup_entry));
+    table->capacity = capacity;
+    table->count = 0;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old[i].raw_size == 0 || old[i].file < 0)
+            continue;
+        if (sample && old[i].hash[1] % DEDUP_SAMPLE != 0)
+            continue;
+        dedup_insert(table, &old[i]);
+    }
+    free(old);
+}
+
+/**
+ * Starts a new archive. Blocks added from now on belong to it.
+ * @param table table of compressed blocks
+ * @param archive_name name of the archive being written
+ **/
+void dedup_start_file(dedup_table *table, char *archive_name) {
+    table->files = realloc(table->files, sizeof(char *) * (table->nfiles + 1));
+    table->files[table->nfiles] = malloc(strlen(archive_name) + 1);
+    strcpy(table->files[table->nfiles], archive_name);
+    table->nfiles++;
+}
+
+/**
+ * Searches a block already compressed with the same content.
+ * @param table table of compressed blocks
+ * @param hash hash of the block
+ * @param raw_size size of the block
+ *
+ * @return Pointer to the entry of the block, NULL if not found.
+ **/
+dedup_entry *dedup_find(dedup_table *table, unsigned long long *hash, int raw_size) {
+    int slot = hash[0] & (table->capacity - 1);
+    while (table->entries[slot].raw_size != 0) {
+        dedup_entry *entry = &table->entries[slot];
+        if (entry->hash[0] == hash[0] && entry->hash[1] == hash[1] && entry->raw_size == raw_size)
+            return entry;
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    return NULL;
+}
+
+/**
+ * Adds a block of the archive being written.
+ * @param table table of compressed blocks
+ * @param hash hash of the block
+ * @param raw_size size of the block
+ * @param block index of the block in the archive
+ **/
+void dedup_add(dedup_table *table, unsigned long long *hash, int raw_size, int block) {
+    // keep table at most half full
+    if (2 * (table->count + 1) > table->capacity) {
+        if (table->max_capacity && 2 * table->capacity > table->max_capacity)
+            return;
+        dedup_rebuild(table, 2 * table->capacity, 0);
+    }
+
+    dedup_entry entry = {{hash[0], hash[1]}, raw_size, table->nfiles - 1, block};
+    dedup_insert(table, &entry);
+}
+
+/**
+ * Ends the archive being written. Without a limit all its blocks are kept for the next archives.
+ * With one only a sample is, chosen by hash so the same content is always either kept or dropped,
+ * leaving room for the blocks of the next archives.
+ * @param table table of compressed blocks
+ **/
+void dedup_end_file(dedup_table *table) {
+    if (table->max_capacity)
+        dedup_rebuild(table, table->capacity, 1);
+}
+
+/**
+ * Forgets the blocks of an archive about to be written again, so no reference points to blocks
+ * it will no longer have.
+ * @param table table of compressed blocks
+ * @param archive_name name of the archive
+ **/
+void dedup_drop_file(dedup_table *table, char *archive_name) {
+    char *path = realpath(archive_name, NULL);
+    int dropped = 0;
+    for (int f = 0; f < table->nfiles; f++) {
+        char *other = path ? realpath(table->files[f], NULL) : NULL;
+        int same = other ? strcmp(path, other) == 0 : strcmp(archive_name, table->files[f]) == 0;
+        free(other);
+        if (!same)
+            continue;
+        for (int i = 0; i < table->capacity; i++) {
+            if (table->entries[i].raw_size != 0 && table->entries[i].file == f) {
+                table->entries[i].file = -1;
+                dropped = 1;
+            }
+        }
+    }
+    free(path);
+    if (dropped)
+        dedup_rebuild(table, table->capacity, 0);
+}
+
+/**
+ * Memory taken by a table of compressed blocks at most, while being rebuilt (old and new entries).
+ * @param max_capacity most entries of the table
+ *
+ * @return bytes
+ **/
+long long dedup_memory(int max_capacity) {
+    return sizeof(dedup_table) + 2LL * max_capacity * sizeof(dedup_entry);
+}
+
+/**
+ * Frees a table of compressed blocks.
+ * @param table pointer to table to free
+ **/
+void dedup_free(dedup_table *table) {
+    for (int i = 0; i < table->nfiles; i++) {
+        free(table->files[i]);
+    }
+    free(table->files);
+    free(table->entries);
+    free(table);
+}
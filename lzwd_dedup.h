@@ -0,0 +1,44 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#ifndef LZWD_DEDUP
+#define LZWD_DEDUP
+
+#include "lzwd_lib.h"
+
+// DEFINES
+#define DEDUP_SAMPLE 8 // with a memory limit, 1 in DEDUP_SAMPLE block hashes of finished files is kept for the next files
+
+// bloco ja comprimido
+typedef struct dedup_entry {
+    unsigned long long hash[2]; // 128 bit hash of source block
+    int raw_size;               // source bytes in block
+    int file;                   // archive holding the block, index in files (-1 once dropped)
+    int block;                  // index of block in its archive
+} dedup_entry;
+
+// tabela de blocos ja comprimidos (open addressing)
+typedef struct dedup_table {
+    dedup_entry *entries;
+    int capacity; // power of 2
+    int max_capacity; // blocks are no longer added once the table would grow past it, 0 for no limit
+    int count;
+    char **files; // names of archives, last one is the one being written
+    int nfiles;
+} dedup_table;
+
+void block_hash(byte *data, int size, unsigned long long *hash);
+
+dedup_table *create_dedup();
+void dedup_start_file(dedup_table *table, char *archive_name);
+dedup_entry *dedup_find(dedup_table *table, unsigned long long *hash, int raw_size);
+void dedup_add(dedup_table *table, unsigned long long *hash, int raw_size, int block);
+void dedup_end_file(dedup_table *table);
+void dedup_drop_file(dedup_table *table, char *archive_name);
+void dedup_free(dedup_table *table);
+long long dedup_memory(int max_capacity);
+
+#endif
@@ -0,0 +1,394 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#include "lzwd_file.h"
+#include "lzwd_huffman.h"
+
+/**
+ * Checksum of a block payload (FNV-1a).
+ * @param data bytes to check
+ * @param size number of bytes
+ *
+ * @return 32 bit checksum
+ **/
+unsigned int checksum(byte *data, int size) {
+    unsigned int hash_value = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash_value ^= data[i];
+        hash_value *= 16777619u;
+    }
+    return hash_value;
+}
+
+/**
+ * Writes the file header at the start of the file. Leaves the file positioned at its end.
+ * @param file file to write to
+ * @param header header to write
+ *
+ * @return 0 if ok, -1 on write error
+ **/
+int write_file_header(FILE *file, file_header *header) {
+    byte raw[FILE_HEADER_SIZE];
+    memset(raw, 0, FILE_HEADER_SIZE);
+    memcpy(raw, FILE_MAGIC, 4);
+    raw[4] = FILE_VERSION;
+    raw[5] = header->algorithm;
+    raw[6] = header->parse_level;
+    while ((1 << raw[7]) < header->dict_size) {
+        raw[7]++;
+    }
+    put_u32(raw + 8, header->block_size);
+    put_u32(raw + 12, header->block_count);
+    put_u32(raw + 16, (unsigned int)header->src_size);
+    put_u32(raw + 20, (unsigned int)(header->src_size >> 32));
+
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(raw, 1, FILE_HEADER_SIZE, file) != FILE_HEADER_SIZE)
+        return -1;
+    return fseek(file, 0, SEEK_END);
+}
+
+/**
+ * Fills the header of a block and writes it, followed by its payload.
+ * @param block header space (BLOCK_HEADER_SIZE bytes) followed by the payload
+ * @return number of bytes written, -1 on write error
+ **/
+static int put_block(FILE *file, byte *block, int method, int raw_size, int ncodes, int payload_size) {
+    memset(block, 0, BLOCK_HEADER_SIZE);
+    block[0] = BLOCK_MAGIC;
+    block[1] = method;
+    put_u32(block + 4, raw_size);
+    put_u32(block + 8, ncodes);
+    put_u32(block + 12, payload_size);
+    put_u32(block + 16, checksum(block + BLOCK_HEADER_SIZE, payload_size));
+
+    if (debugflag)
+        printf(DEBUG_TXT "Block written: %d indexes in %d bytes (method %d).\n" RESET_TXT, ncodes, payload_size, method);
+
+    int written = BLOCK_HEADER_SIZE + payload_size;
+    if (fwrite(block, 1, written, file) != written)
+        written = -1;
+    return written;
+}
+
+/**
+ * Encodes the indexes of a block. Indexes are huffman coded if entropyflag is set and that makes
+ * the payload smaller.
+ * @param codes dictionary indexes of the block
+ * @param ncodes number of indexes
+ * @param payload where to write the payload (room for 2 * ncodes bytes)
+ * @param method where to save the method used
+ *
+ * @return payload size
+ **/
+static int encode_payload(int *codes, int ncodes, byte *payload, int *method) {
+    int payload_size = -1;
+    if (entropyflag)
+        payload_size = huffman_encode(codes, ncodes, payload, 2 * ncodes - 1);
+    if (payload_size >= 0) {
+        *method = METHOD_HUFFMAN;
+        return payload_size;
+    }
+
+    *method = METHOD_RAW;
+    for (int i = 0; i < ncodes; i++) {
+        payload[2 * i] = (byte)codes[i];
+        payload[2 * i + 1] = (byte)(codes[i] >> 8);
+    }
+    return 2 * ncodes;
+}
+
+/**
+ * Writes an encoded block (header and payload) at the current position of the file.
+ * @param file file to write to
+ * @param codes dictionary indexes of the block
+ * @param ncodes number of indexes
+ * @param raw_size number of source bytes encoded in the block
+ *
+ * @return number of bytes written, -1 on write error
+ **/
+int write_block(FILE *file, int *codes, int ncodes, int raw_size) {
+    byte *block = malloc(BLOCK_HEADER_SIZE + 2 * ncodes);
+    int method;
+    int payload_size = encode_payload(codes, ncodes, block + BLOCK_HEADER_SIZE, &method);
+
+    int written = put_block(file, block, method, raw_size, ncodes, payload_size);
+    free(block);
+    return written;
+}
+
+/**
+ * Size an encoded block would take in a compressed file, without writing it.
+ * @param codes dictionary indexes of the block
+ * @param ncodes number of indexes
+ *
+ * @return size of header and payload
+ **/
+int encoded_block_size(int *codes, int ncodes) {
+    byte *payload = malloc(2 * ncodes + 1);
+    int method;
+    int payload_size = encode_payload(codes, ncodes, payload, &method);
+    free(payload);
+    return BLOCK_HEADER_SIZE + payload_size;
+}
+
+/**
+ * Writes a block that is a copy of another one, already in this or another archive.
+ * @param file file to write to
+ * @param ref block to copy
+ * @param raw_size number of source bytes in the block
+ *
+ * @return number of bytes written, -1 on write error
+ **/
+int write_ref_block(FILE *file, block_ref *ref, int raw_size) {
+    int name_size = strlen(ref->archive);
+    int payload_size = 20 + name_size;
+    byte *block = malloc(BLOCK_HEADER_SIZE + payload_size);
+    byte *payload = block + BLOCK_HEADER_SIZE;
+
+    put_u32(payload, (unsigned int)ref->hash[0]);
+    put_u32(payload + 4, (unsigned int)(ref->hash[0] >> 32));
+    put_u32(payload + 8, (unsigned int)ref->hash[1]);
+    put_u32(payload + 12, (unsigned int)(ref->hash[1] >> 32));
+    put_u32(payload + 16, ref->block);
+    memcpy(payload + 20, ref->archive, name_size);
+
+    int written = put_block(file, block, METHOD_REF, raw_size, 0, payload_size);
+    free(block);
+    return written;
+}
+
+/**
+ * Names an archive for a reference block, relative to the directory of the archive holding the
+ * reference so both can be moved together.
+ * @param from archive holding the reference
+ * @param to archive referenced
+ * @param name where to save the name (REF_NAME_MAX bytes)
+ *
+ * @return 0 if ok, -1 if an archive doesn't exist or the name is too long
+ **/
+int ref_archive_name(char *from, char *to, char *name) {
+    char *from_path = realpath(from, NULL);
+    char *to_path = realpath(to, NULL);
+    int status = -1;
+
+    if (from_path && to_path) {
+        // directories both paths start with
+        int common = 0;
+        for (int i = 0; from_path[i] && from_path[i] == to_path[i]; i++) {
+            if (from_path[i] == '/')
+                common = i + 1;
+        }
+        // one "../" for every other directory of from
+        int ups = 0;
+        for (char *c = from_path + common; *c; c++) {
+            if (*c == '/')
+                ups++;
+        }
+        if (3 * ups + strlen(to_path + common) < REF_NAME_MAX) {
+            name[0] = '\0';
+            for (int i = 0; i < ups; i++) {
+                strcat(name, "../");
+            }
+            strcat(name, to_path + common);
+            status = 0;
+        }
+    }
+    free(from_path);
+    free(to_path);
+    return status;
+}
+
+/**
+ * Path of an archive named by a reference block, as seen from the current directory.
+ * @param from archive holding the reference
+ * @param name archive name saved in the reference
+ *
+ * @return newly allocated path
+ **/
+char *ref_archive_path(char *from, char *name) {
+    char *slash = strrchr(from, '/');
+    int dir_size = name[0] != '/' && slash ? slash - from + 1 : 0;
+    char *path = malloc(dir_size + strlen(name) + 1);
+    memcpy(path, from, dir_size);
+    strcpy(path + dir_size, name);
+    return path;
+}
+
+/**
+ * Reads the file header from the start of the file. Leaves the file positioned at the first block.
+ * @param file file to read from
+ * @param header where to save the header
+ *
+ * @return 0 if ok, -1 if file is not a compressed file
+ **/
+int read_file_header(FILE *file, file_header *header) {
+    byte raw[FILE_HEADER_SIZE];
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(raw, 1, FILE_HEADER_SIZE, file) != FILE_HEADER_SIZE)
+        return -1;
+    if (memcmp(raw, FILE_MAGIC, 4) != 0 || raw[4] < 1 || raw[4] > FILE_VERSION)
+        return -1;
+    if (raw[5] != ALGO_LZW && raw[5] != ALGO_LZWD)
+        return -1;
+
+    header->algorithm = raw[5];
+    header->parse_level = raw[6];
+    header->block_size = get_u32(raw + 8);
+    header->block_count = get_u32(raw + 12);
+    header->src_size = get_u32(raw + 16) | ((long long)get_u32(raw + 20) << 32);
+    header->dict_size = raw[4] >= 2 && raw[7] ? 1 << raw[7] : DICT_SIZE;
+    if (header->dict_size < DICT_SIZE_MIN || header->dict_size > DICT_SIZE)
+        return -1;
+    return 0;
+}
+
+/**
+ * Reads a block header at the current position of the file.
+ * @param file file to read from
+ * @param header where to save the header
+ *
+ * @return 0 if ok, -1 at end of file or if header is not valid
+ **/
+int read_block_header(FILE *file, block_header *header) {
+    byte raw[BLOCK_HEADER_SIZE];
+    if (fread(raw, 1, BLOCK_HEADER_SIZE, file) != BLOCK_HEADER_SIZE || raw[0] != BLOCK_MAGIC)
+        return -1;
+
+    header->method = raw[1];
+    header->raw_size = get_u32(raw + 4);
+    header->ncodes = get_u32(raw + 8);
+    header->payload_size = get_u32(raw + 12);
+    header->check = get_u32(raw + 16);
+    if (header->raw_size < 0 || header->ncodes < 0 || header->payload_size < 0 || header->ncodes > header->raw_size)
+        return -1;
+    return 0;
+}
+
+/**
+ * Reads the payload of a block, right after its header, and decodes its indexes.
+ * @param file file to read from
+ * @param header header of the block
+ * @param codes where to save the indexes (room for header->ncodes)
+ *
+ * @return 0 if ok, -1 if payload is missing or corrupted
+ **/
+int read_block_codes(FILE *file, block_header *header, int *codes) {
+    byte *payload = malloc(header->payload_size + 1);
+    int result = -1;
+
+    if (fread(payload, 1, header->payload_size, file) == header->payload_size &&
+        checksum(payload, header->payload_size) == header->check) {
+        if (header->method == METHOD_RAW && header->payload_size == 2 * header->ncodes) {
+            for (int i = 0; i < header->ncodes; i++) {
+                codes[i] = payload[2 * i] | (payload[2 * i + 1] << 8);
+            }
+            result = 0;
+        } else if (header->method == METHOD_HUFFMAN) {
+            result = huffman_decode(payload, header->payload_size, codes, header->ncodes);
+        }
+    }
+
+    free(payload);
+    return result;
+}
+
+/**
+ * Reads the payload of a block written by write_ref_block, right after its header.
+ * @param file file to read from
+ * @param header header of the block
+ * @param ref where to save the block referenced
+ *
+ * @return 0 if ok, -1 if payload is missing or corrupted
+ **/
+int read_block_ref(FILE *file, block_header *header, block_ref *ref) {
+    int name_size = header->payload_size - 20;
+    if (header->method != METHOD_REF || name_size < 0 || name_size >= REF_NAME_MAX)
+        return -1;
+
+    byte payload[20 + REF_NAME_MAX];
+    if (fread(payload, 1, header->payload_size, file) != header->payload_size ||
+        checksum(payload, header->payload_size) != header->check)
+        return -1;
+
+    ref->hash[0] = get_u32(payload) | ((unsigned long long)get_u32(payload + 4) << 32);
+    ref->hash[1] = get_u32(payload + 8) | ((unsigned long long)get_u32(payload + 12) << 32);
+    ref->block = get_u32(payload + 16);
+    memcpy(ref->archive, payload + 20, name_size);
+    ref->archive[name_size] = '\0';
+    return 0;
+}
+
+/**
+ * Positions the file at the payload of a block, walking the block headers from the first one.
+ * @param file file to read from
+ * @param index index of the block (0 for first)
+ * @param header where to save the header of the block
+ *
+ * @return 0 if ok, -1 if the file doesn't have that block
+ **/
+int seek_block(FILE *file, int index, block_header *header) {
+    if (fseek(file, FILE_HEADER_SIZE, SEEK_SET) != 0)
+        return -1;
+    for (int i = 0; i <= index; i++) {
+        if (read_block_header(file, header) != 0)
+            return -1;
+        if (i < index && fseek(file, header->payload_size, SEEK_CUR) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * Walks the blocks of a compressed file from the current position, stopping at the first one that
+ * is missing or not valid.
+ * @param file file to read from, positioned at a block header
+ * @param max_blocks most blocks to walk, -1 for no limit
+ * @param verify if true payloads are read and their checksum checked
+ * @param block_count incremented for every valid block
+ * @param src_size incremented with the source bytes of every valid block
+ *
+ * @return position right after the last valid block
+ **/
+long scan_blocks(FILE *file, int max_blocks, int verify, int *block_count, long long *src_size) {
+    long end = ftell(file);
+    block_header header;
+    byte *payload = NULL;
+
+    for (int i = 0; max_blocks < 0 || i < max_blocks; i++) {
+        if (read_block_header(file, &header) != 0)
+            break;
+        if (verify) {
+            payload = realloc(payload, header.payload_size + 1);
+            if (fread(payload, 1, header.payload_size, file) != header.payload_size ||
+                checksum(payload, header.payload_size) != header.check)
+                break;
+        } else if (fseek(file, header.payload_size, SEEK_CUR) != 0) {
+            break;
+        }
+        (*block_count)++;
+        *src_size += header.raw_size;
+        end = ftell(file);
+    }
+
+    free(payload);
+    fseek(file, end, SEEK_SET);
+    return end;
+}
+
+/**
+ * Saves the file header once all blocks written are safely stored, so readers only ever see
+ * block counts of blocks that are complete.
+ * @param file file to write to
+ * @param header header to write
+ *
+ * @return 0 if ok, -1 on write error
+ **/
+int commit_file_header(FILE *file, file_header *header) {
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0)
+        return -1;
+    if (write_file_header(file, header) != 0 || fflush(file) != 0 || fsync(fileno(file)) != 0)
+        return -1;
+    return 0;
+}
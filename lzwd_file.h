@@ -0,0 +1,92 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#ifndef LZWD_FILE
+#define LZWD_FILE
+
+#include "lzwd_lib.h"
+
+// DEFINES
+#define FILE_MAGIC "LZWD"
+#define FILE_VERSION 2 // version 2 added the dictionary bits, files of version 1 all use DICT_SIZE
+#define FILE_HEADER_SIZE 32
+#define BLOCK_MAGIC 0xB1
+#define BLOCK_HEADER_SIZE 20
+#define REF_NAME_MAX 1024 // longest archive name in a reference block
+
+// algorithm used to encode the file
+#define ALGO_LZW 0
+#define ALGO_LZWD 1
+
+// how the indexes of a block are stored
+#define METHOD_RAW 0     // 2 bytes per index (little endian)
+#define METHOD_HUFFMAN 1 // canonical huffman codes, see lzwd_huffman.h
+#define METHOD_REF 2     // no indexes, same content as another block, see block_ref
+
+/*
+ * Compressed file layout:
+ * [file header][block header][block payload][block header][block payload]...
+ *
+ * file header (FILE_HEADER_SIZE bytes, integers little endian):
+ *  0 magic "LZWD"    4 version    5 algorithm    6 parsing level    7 dictionary bits (0 for 12, version 2)
+ *  8 block size     12 block count    16 source size (8 bytes)    24 unused
+ *
+ * block header (BLOCK_HEADER_SIZE bytes):
+ *  0 BLOCK_MAGIC    1 method    2 unused (2 bytes)
+ *  4 source bytes in block    8 number of indexes    12 payload size    16 payload checksum
+ *
+ * reference block payload (METHOD_REF):
+ *  0 hash of source block (16 bytes)    16 index of block referenced (0 for first)
+ *  20 name of archive holding it, without terminator (empty for this archive). Relative names are
+ *     relative to the directory of the archive holding the reference
+ */
+
+// cabecalho do ficheiro
+typedef struct file_header {
+    int algorithm;
+    int parse_level;
+    int block_size;
+    int block_count;
+    long long src_size;
+    int dict_size; // dictionary entries before it is cleared, power of 2
+} file_header;
+
+// cabecalho de um bloco
+typedef struct block_header {
+    int method;
+    int raw_size;     // source bytes encoded in the block
+    int ncodes;       // number of dictionary indexes
+    int payload_size; // bytes after the header
+    unsigned int check;
+} block_header;
+
+// referencia para um bloco igual
+typedef struct block_ref {
+    unsigned long long hash[2];
+    int block;
+    char archive[REF_NAME_MAX]; // empty for the same archive, else relative to the archive holding the reference
+} block_ref;
+
+extern int entropyflag;
+
+unsigned int checksum(byte *data, int size);
+
+int write_file_header(FILE *file, file_header *header);
+int commit_file_header(FILE *file, file_header *header);
+int write_block(FILE *file, int *codes, int ncodes, int raw_size);
+int write_ref_block(FILE *file, block_ref *ref, int raw_size);
+int ref_archive_name(char *from, char *to, char *name);
+char *ref_archive_path(char *from, char *name);
+int encoded_block_size(int *codes, int ncodes);
+
+int read_file_header(FILE *file, file_header *header);
+int read_block_header(FILE *file, block_header *header);
+int read_block_codes(FILE *file, block_header *header, int *codes);
+int read_block_ref(FILE *file, block_header *header, block_ref *ref);
+int seek_block(FILE *file, int index, block_header *header);
+long scan_blocks(FILE *file, int max_blocks, int verify, int *block_count, long long *src_size);
+
+#endif
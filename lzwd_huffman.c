@@ -0,0 +1,299 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#include "lzwd_huffman.h"
+
+// bit writer, most significant bit first
+typedef struct bit_writer {
+    byte *data;
+    int size;                 // bytes written
+    unsigned long long bits;  // pending bits
+    int nbits;                // number of pending bits
+} bit_writer;
+
+// bit reader, most significant bit first. Reads zeros past the end of data
+typedef struct bit_reader {
+    byte *data;
+    int size;
+    int pos;
+    unsigned long long bits;
+    int nbits;
+} bit_reader;
+
+static void write_bits(bit_writer *writer, unsigned int code, int length) {
+    writer->bits = (writer->bits << length) | code;
+    writer->nbits += length;
+    while (writer->nbits >= 8) {
+        writer->nbits -= 8;
+        writer->data[writer->size++] = (byte)(writer->bits >> writer->nbits);
+    }
+}
+
+static void flush_bits(bit_writer *writer) {
+    if (writer->nbits > 0) {
+        writer->data[writer->size++] = (byte)(writer->bits << (8 - writer->nbits));
+        writer->nbits = 0;
+    }
+}
+
+static unsigned int peek_bits(bit_reader *reader) {
+    while (reader->nbits <= 56) {
+        byte next = reader->pos < reader->size ? reader->data[reader->pos] : 0;
+        reader->pos++;
+        reader->bits = (reader->bits << 8) | next;
+        reader->nbits += 8;
+    }
+    return (unsigned int)(reader->bits >> (reader->nbits - HUFF_MAX_BITS)) & ((1 << HUFF_MAX_BITS) - 1);
+}
+
+// leaves are sorted as frequency << 16 | symbol, so no shared state is needed (thread safe)
+static int compare_leaves(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Computes huffman code lengths for the given symbol frequencies (two queue method).
+ * @param freq frequency of every symbol, DICT_SIZE entries
+ * @param lengths where to save the code length of every symbol (0 for unused symbols)
+ *
+ * @return longest code length
+ **/
+static int build_lengths(int *freq, byte *lengths) {
+    long long keys[DICT_SIZE];
+    int leaves[DICT_SIZE];
+    int nleaves = 0;
+    memset(lengths, 0, DICT_SIZE);
+    for (int s = 0; s < DICT_SIZE; s++) {
+        if (freq[s] > 0)
+            keys[nleaves++] = ((long long)freq[s] << 16) | s;
+    }
+    if (nleaves == 0)
+        return 0;
+    qsort(keys, nleaves, sizeof(long long), compare_leaves);
+    for (int i = 0; i < nleaves; i++) {
+        leaves[i] = keys[i] & 0xFFFF;
+    }
+    if (nleaves == 1) {
+        lengths[leaves[0]] = 1;
+        return 1;
+    }
+
+    // nodes 0..nleaves-1 are the sorted leaves, the rest are internal nodes in creation order
+    int nnodes = 2 * nleaves - 1;
+    long long *weight = malloc(sizeof(long long) * nnodes);
+    int *parent = malloc(sizeof(int) * nnodes);
+    for (int i = 0; i < nleaves; i++) {
+        weight[i] = freq[leaves[i]];
+    }
+
+    int next_leaf = 0, next_node = nleaves;
+    for (int node = nleaves; node < nnodes; node++) {
+        int pick[2];
+        for (int p = 0; p < 2; p++) {
+            if (next_leaf < nleaves && (next_node >= node || weight[next_leaf] <= weight[next_node]))
+                pick[p] = next_leaf++;
+            else
+                pick[p] = next_node++;
+        }
+        weight[node] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = parent[pick[1]] = node;
+    }
+
+    // depth of every node, root is the last one created
+    int *depth = malloc(sizeof(int) * nnodes);
+    int max_length = 0;
+    depth[nnodes - 1] = 0;
+    for (int node = nnodes - 2; node >= 0; node--) {
+        depth[node] = depth[parent[node]] + 1;
+        if (node < nleaves) {
+            lengths[leaves[node]] = depth[node] > 255 ? 255 : depth[node];
+            if (depth[node] > max_length)
+                max_length = depth[node];
+        }
+    }
+
+    free(weight);
+    free(parent);
+    free(depth);
+    return max_length;
+}
+
+/**
+ * Assigns canonical codes from code lengths (shorter codes first, then by symbol).
+ * @param lengths code length of every symbol
+ * @param codes where to save the code of every symbol
+ **/
+static void canonical_codes(byte *lengths, unsigned int *codes) {
+    int count[HUFF_MAX_BITS + 1] = {0};
+    unsigned int next[HUFF_MAX_BITS + 1];
+    for (int s = 0; s < DICT_SIZE; s++) {
+        count[lengths[s]]++;
+    }
+    count[0] = 0;
+    unsigned int code = 0;
+    for (int len = 1; len <= HUFF_MAX_BITS; len++) {
+        code = (code + count[len - 1]) << 1;
+        next[len] = code;
+    }
+    for (int s = 0; s < DICT_SIZE; s++) {
+        if (lengths[s])
+            codes[s] = next[lengths[s]]++;
+    }
+}
+
+/**
+ * Encodes a block of dictionary indexes with canonical huffman codes.
+ * @param codes indexes to encode (0 to DICT_SIZE - 1)
+ * @param ncodes number of indexes
+ * @param out buffer to write the payload to
+ * @param out_size size of out
+ *
+ * @return number of bytes written to out, -1 if they didn't fit in out_size
+ **/
+int huffman_encode(int *codes, int ncodes, byte *out, int out_size) {
+    int freq[DICT_SIZE] = {0};
+    byte lengths[DICT_SIZE];
+    unsigned int symbol_codes[DICT_SIZE];
+
+    for (int i = 0; i < ncodes; i++) {
+        freq[codes[i]]++;
+    }
+    // limit code lengths by flattening the frequencies until the tree is short enough
+    while (build_lengths(freq, lengths) > HUFF_MAX_BITS) {
+        for (int s = 0; s < DICT_SIZE; s++) {
+            if (freq[s] > 0)
+                freq[s] = (freq[s] + 1) / 2;
+        }
+    }
+    canonical_codes(lengths, symbol_codes);
+
+    // code lengths table
+    int size = 0;
+    for (int s = 0; s < DICT_SIZE;) {
+        if (size + 1 + 4 * HUFF_STREAMS > out_size)
+            return -1;
+        if (lengths[s]) {
+            out[size++] = lengths[s++];
+            continue;
+        }
+        int run = 0;
+        while (s < DICT_SIZE && !lengths[s] && run < 128) {
+            run++;
+            s++;
+        }
+        out[size++] = 0x80 | (run - 1);
+    }
+
+    // interleaved streams, written in place after their sizes
+    byte *sizes = out + size;
+    size += 4 * HUFF_STREAMS;
+    for (int st = 0; st < HUFF_STREAMS; st++) {
+        long long stream_bits = 0;
+        for (int i = st; i < ncodes; i += HUFF_STREAMS) {
+            stream_bits += lengths[codes[i]];
+        }
+        int stream_size = (int)((stream_bits + 7) / 8);
+        if (size + stream_size > out_size)
+            return -1;
+
+        bit_writer writer = {out + size, 0, 0, 0};
+        for (int i = st; i < ncodes; i += HUFF_STREAMS) {
+            write_bits(&writer, symbol_codes[codes[i]], lengths[codes[i]]);
+        }
+        flush_bits(&writer);
+        put_u32(sizes + 4 * st, writer.size);
+        size += writer.size;
+    }
+    return size;
+}
+
+/**
+ * Decodes a block of dictionary indexes written by huffman_encode.
+ * @param in payload to read from
+ * @param in_size size of payload
+ * @param codes where to save the indexes
+ * @param ncodes number of indexes to decode
+ *
+ * @return 0 if ok, -1 if payload is corrupted
+ **/
+int huffman_decode(byte *in, int in_size, int *codes, int ncodes) {
+    byte lengths[DICT_SIZE];
+    unsigned int symbol_codes[DICT_SIZE];
+
+    // code lengths table
+    int pos = 0;
+    for (int s = 0; s < DICT_SIZE;) {
+        if (pos >= in_size)
+            return -1;
+        byte value = in[pos++];
+        if (value & 0x80) {
+            int run = (value & 0x7F) + 1;
+            if (s + run > DICT_SIZE)
+                return -1;
+            memset(lengths + s, 0, run);
+            s += run;
+        } else {
+            if (value == 0 || value > HUFF_MAX_BITS)
+                return -1;
+            lengths[s++] = value;
+        }
+    }
+
+    // reject over-subscribed lengths, they would overflow the table
+    long long space = 0;
+    for (int s = 0; s < DICT_SIZE; s++) {
+        if (lengths[s])
+            space += 1 << (HUFF_MAX_BITS - lengths[s]);
+    }
+    if (space > (1 << HUFF_MAX_BITS))
+        return -1;
+    canonical_codes(lengths, symbol_codes);
+
+    // decoding table indexed by the next HUFF_MAX_BITS bits: symbol << 4 | length (0 if invalid)
+    unsigned int *table = calloc(1 << HUFF_MAX_BITS, sizeof(unsigned int));
+    for (int s = 0; s < DICT_SIZE; s++) {
+        if (!lengths[s])
+            continue;
+        int shift = HUFF_MAX_BITS - lengths[s];
+        unsigned int first = symbol_codes[s] << shift;
+        for (unsigned int j = 0; j < (1u << shift); j++) {
+            table[first + j] = (s << 4) | lengths[s];
+        }
+    }
+
+    if (pos + 4 * HUFF_STREAMS > in_size) {
+        free(table);
+        return -1;
+    }
+    bit_reader readers[HUFF_STREAMS];
+    int data_pos = pos + 4 * HUFF_STREAMS;
+    for (int st = 0; st < HUFF_STREAMS; st++) {
+        int stream_size = get_u32(in + pos + 4 * st);
+        if (stream_size < 0 || stream_size > in_size - data_pos) {
+            free(table);
+            return -1;
+        }
+        readers[st] = (bit_reader){in + data_pos, stream_size, 0, 0, 0};
+        data_pos += stream_size;
+    }
+
+    for (int i = 0; i < ncodes; i++) {
+        bit_reader *reader = &readers[i % HUFF_STREAMS];
+        unsigned int entry = table[peek_bits(reader)];
+        int length = entry & 0xF;
+        reader->nbits -= length;
+        // invalid code or code reaching past the end of its stream
+        if (length == 0 || 8LL * reader->pos - reader->nbits > 8LL * reader->size) {
+            free(table);
+            return -1;
+        }
+        codes[i] = entry >> 4;
+    }
+
+    free(table);
+    return 0;
+}
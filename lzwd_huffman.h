@@ -0,0 +1,27 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#ifndef LZWD_HUFFMAN
+#define LZWD_HUFFMAN
+
+#include "lzwd_lib.h"
+
+// DEFINES
+#define HUFF_MAX_BITS 15 // longest code allowed, also the size of the decoding table index
+#define HUFF_STREAMS 4   // number of interleaved bit streams, symbol i goes to stream i % HUFF_STREAMS
+
+/*
+ * Payload of a huffman coded block:
+ * [code lengths][stream sizes][stream 0]...[stream HUFF_STREAMS-1]
+ * code lengths: one byte per symbol (1 to HUFF_MAX_BITS), or 0x80 | (n-1) for n unused symbols in a row.
+ * stream sizes: 4 bytes (little endian) per stream.
+ * streams: canonical codes written most significant bit first.
+ */
+
+int huffman_encode(int *codes, int ncodes, byte *out, int out_size);
+int huffman_decode(byte *in, int in_size, int *codes, int ncodes);
+
+#endif
@@ -27,7 +27,12 @@ int hash(int *key, int size) {
  **/
 dict *create_dict() {
     dict *dictionary = malloc(sizeof(dict) * 1);
-    dictionary->entries = malloc(sizeof(d_entry) * DICT_SIZE);
+    dictionary->entries = malloc(sizeof(d_entry *) * DICT_SIZE);
+    dictionary->nodes = malloc(sizeof(d_entry) * DICT_SIZE);
+    dictionary->nnodes = 0;
+    dictionary->keys_capacity = dict_key_max ? dict_key_max : 16 * DICT_SIZE;
+    dictionary->keys = malloc(dictionary->keys_capacity);
+    dictionary->keys_size = 0;
 
     // set all entries as empty
     for (int i = 0; i < DICT_SIZE; i++) {
@@ -46,20 +51,44 @@ dict *create_dict() {
 }
 
 /**
- * Creates new dictionary entry. Allocating memory for it.
+ * Memory taken by a dictionary at most, with the limits currently set (dict_key_max).
  *
+ * @return bytes
+ **/
+long long dict_memory() {
+    return sizeof(dict) + (sizeof(d_entry *) + sizeof(d_entry)) * DICT_SIZE + dict_key_max;
+}
+
+/**
+ * Creates new dictionary entry, taking the next free node of the dictionary. The pattern is
+ * kept only if it fits in pattern_max and the keys of the dictionary (always when there is no
+ * limit), otherwise the entry still takes its index but never matches.
+ *
+ * @param dictionary dictionary the entry belongs to.
  * @param key pattern.
  * @param value pattern index.
  * @param size pattern size.
  * @return Pointer to dictionary entry.
  **/
-d_entry *map_pair(int *key, int value, int size) {
+d_entry *map_pair(dict *dictionary, int *key, int value, int size) {
 
-    d_entry *entry = malloc(sizeof(d_entry));
-    entry->key = malloc(sizeof(int) * size);
+    d_entry *entry = &dictionary->nodes[dictionary->nnodes++];
+    entry->key = -1;
 
-    for (int i = 0; i < size; i++) {
-        entry->key[i] = key[i];
+    if (!pattern_max || size <= pattern_max) {
+        if (!dict_key_max && dictionary->keys_size + size > dictionary->keys_capacity) {
+            while (dictionary->keys_size + size > dictionary->keys_capacity) {
+                dictionary->keys_capacity *= 2;
+            }
+            dictionary->keys = realloc(dictionary->keys, dictionary->keys_capacity);
+        }
+        if (dictionary->keys_size + size <= dictionary->keys_capacity) {
+            entry->key = dictionary->keys_size;
+            for (int i = 0; i < size; i++) {
+                dictionary->keys[entry->key + i] = key[i];
+            }
+            dictionary->keys_size += size;
+        }
     }
 
     entry->value = value;
@@ -76,8 +105,9 @@ d_entry *map_pair(int *key, int value, int size) {
  * @param key pattern.
  * @param value pattern index.
  * @param size pattern size.
+ * @return 1 if the pattern was kept, 0 if the entry never matches (see map_pair)
  **/
-void dict_add(dict *dictionary, int *key, int value, int size) {
+int dict_add(dict *dictionary, int *key, int value, int size) {
 
     int slot = hash(key, size);
     d_entry *new = dictionary->entries[slot];
@@ -89,10 +119,10 @@ void dict_add(dict *dictionary, int *key, int value, int size) {
     }
     // found entry empty so insert
     if (new == -1) {
-        dictionary->entries[slot] = map_pair(key, value, size);
+        new = dictionary->entries[slot] = map_pair(dictionary, key, value, size);
         if (debugflag)
             printf("Empty entry. Added.\n");
-        return;
+        return new->key != -1;
     }
 
     // otherwise an colission occured
@@ -104,9 +134,10 @@ void dict_add(dict *dictionary, int *key, int value, int size) {
     }
 
     // end of chain reached, add new
-    prev->next = map_pair(key, value, size);
+    new = prev->next = map_pair(dictionary, key, value, size);
     if (debugflag)
         printf("Found collision. Added to end of chain.\n");
+    return new->key != -1;
 }
 
 /**
@@ -139,7 +170,8 @@ int dict_get_value(dict *dictionary, int *key, int size) {
     // match found, walk the entries
     while (d_search != -1) {
         // check equal key
-        if (compare_pattern(key, size, d_search->key, d_search->length) == 1) {
+        if (d_search->key != -1 && d_search->length == size &&
+            compare_key(key, dictionary->keys + d_search->key, size) == 1) {
             if (debugflag)
                 printf("Match found. Idx: %d\n", d_search->value);
             return d_search->value;
@@ -175,6 +207,23 @@ int compare_pattern(int *pattern_x, int size_x, int *pattern_y, int size_y) {
     return 1;
 }
 
+/**
+ * Compare a pattern with a key kept in a dictionary.
+ * @param pattern pattern to compare
+ * @param key symbols of the key
+ * @param size size of both
+ *
+ * @return 0 if different, 1 if equal
+ **/
+int compare_key(int *pattern, byte *key, int size) {
+    for (int i = 0; i < size; i++) {
+        if (pattern[i] != key[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 /**
  * Concatenate two patterns.
  * @param pattern_x first pattern
@@ -212,10 +261,10 @@ void dict_print(dict *dictionary) {
         else {
             // cycle the chain
             while (d_entry != -1) {
-                if (d_entry->value > 255) { // exclude all single symbol entries
+                if (d_entry->value > 255 && d_entry->key != -1) { // exclude all single symbol entries
                     printf("[%d] [%d] [", i, d_entry->value);
                     for (int a = 0; a < d_entry->length; a++) {
-                        printf("%d ", d_entry->key[a]);
+                        printf("%d ", dictionary->keys[d_entry->key + a]);
                     }
                     printf("]\n");
                 }
@@ -231,33 +280,96 @@ void dict_print(dict *dictionary) {
  * @param dictionary pointer to dictionary to free
  */
 void dict_free(dict *dictionary) {
-    for (int i = 0; i < DICT_SIZE; i++) {
-        d_entry *d_entry = dictionary->entries[i];
-        if (d_entry == -1) {
-            continue;
-        } else {
-            // cycle the chain
-            while (d_entry != -1) {
-                // next in chain
-                free(d_entry->key);
-                d_entry = d_entry->next;
-            }
-        }
-    }
+    // entries and their patterns are all in nodes and keys
     free(dictionary->entries);
+    free(dictionary->nodes);
+    free(dictionary->keys);
     if (debugflag)
         printf(DEBUG_TXT "%s" RESET_TXT, "Cleared dictionary.\n");
 }
 
+/**
+ * Writes a 4 byte unsigned integer, little endian.
+ * @param out where to write
+ * @param value value to write
+ **/
+void put_u32(byte *out, unsigned int value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (byte)(value >> (8 * i));
+    }
+}
+
+/**
+ * Reads a 4 byte unsigned integer, little endian.
+ * @param in where to read from
+ * @return value read
+ **/
+unsigned int get_u32(byte *in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((unsigned int)in[3] << 24);
+}
+
+/**
+ * Finds the longest pattern in dictionary that is a prefix of buffer, growing it one symbol at a time.
+ * Only valid for dictionaries where every prefix of a pattern is also a pattern (LZW).
+ * @param dictionary pointer to dictionary where to search
+ * @param buffer symbols to read from
+ * @param nbytes number of symbols available in buffer
+ * @param pattern where to build the pattern (room for the longest pattern in dictionary + 1)
+ * @param idx_by_size if not NULL, saves the index of the prefix with i symbols in idx_by_size[i]
+ *
+ * @return size of the longest pattern found
+ **/
+int dict_longest_prefix(dict *dictionary, byte *buffer, int nbytes, int *pattern, int *idx_by_size) {
+    int size = 0;
+    while (size < nbytes) {
+        pattern[size] = buffer[size];
+        int idx = dict_get_value(dictionary, pattern, size + 1);
+        if (idx == -1)
+            break;
+        size++;
+        if (idx_by_size)
+            idx_by_size[size] = idx;
+    }
+    return size;
+}
+
+/**
+ * Finds the longest pattern in dictionary that is a prefix of buffer, shrinking it one symbol at a time.
+ * Works for any dictionary, since all 1 symbol patterns are in it.
+ * @param dictionary pointer to dictionary where to search
+ * @param buffer symbols to read from
+ * @param nbytes number of symbols available in buffer
+ * @param max_size size of the longest pattern in dictionary
+ * @param pattern where to build the pattern (room for max_size symbols)
+ * @param idx where to save the index of the pattern found
+ *
+ * @return size of the longest pattern found
+ **/
+int dict_longest_pattern(dict *dictionary, byte *buffer, int nbytes, int max_size, int *pattern, int *idx) {
+    int size = nbytes < max_size ? nbytes : max_size;
+    for (int i = 0; i < size; i++) {
+        pattern[i] = buffer[i];
+    }
+    *idx = -1;
+    while (size > 0) {
+        *idx = dict_get_value(dictionary, pattern, size);
+        if (*idx != -1)
+            break;
+        size--;
+    }
+    return size;
+}
+
 /**
  * Encode a given buffer of bytes in to an output buffer using LZWD algorithm.
  * @param buffer_in buffer to read from
  * @param buffer_out buffer to write to
  * @param nbytes number of bytes to process from buffer_in
+ * @param resets if not NULL, incremented every time the dictionary is full and cleared
  *
  * @returns number of bytes written to buffer_out
  **/
-int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out) {
+int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out, int *resets) {
     // print buffer de entrada
     if (textflag || debugflag) {
         printf("buffer_in (lzwd_encode):\n");
@@ -267,6 +379,10 @@ int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out) {
         printf("\n");
     }
 
+    // higher parsing levels look ahead before committing to a pattern
+    if (parse_level > 0)
+        return lzwd_encode_flexible(buffer_in, nbytes, buffer_out, resets);
+
     int N = 0; // apontador de leitura do bloco
     int M = 0; // apontador de escrita do output
     int nextIndex = 256;
@@ -303,8 +419,14 @@ int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out) {
         N = save_N_Pk; /*restore reader pointer to the begging of Pk*/
 
         // 1. Ler Pj apartir de N até padrão não existir ou chegar ao final do ficheiro.
-        for (int i = 0; i < max_pattern_size; i++) { /*extract pattern with current_size symbols*/
-            Pj[size_j++] = ((unsigned char *)buffer_in)[N++];
+        // Pj is the previous Pk, unless the dictionary was just cleared. Searching it again could
+        // find the pattern Pj+Pk just added, which the decoder doesn't know yet.
+        if (idx_j != -1) {
+            N += size_j;
+        } else {
+            for (int i = 0; i < max_pattern_size; i++) { /*extract pattern with current_size symbols*/
+                Pj[size_j++] = ((unsigned char *)buffer_in)[N++];
+            }
         }
 
         if (debugflag) {
@@ -325,6 +447,12 @@ int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out) {
         }
         save_N_Pk = N; /*temp save reader pointer*/
 
+        // Pj reached the end of the block, it is the last index
+        if (N == nbytes) {
+            last_idx_k = idx_j;
+            break;
+        }
+
         // ler Pk aseguir ao final de Pj até padrão não existir ou chegar ao final do ficheiro.
         for (int i = 0; i < max_pattern_size; i++) {
             Pk[size_k++] = ((unsigned char *)buffer_in)[N++];
@@ -349,8 +477,7 @@ int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out) {
 
         // add pattern Pm(Pj+Pk) to dict
         concat_pattern(Pj, size_j, Pk, size_k, Pm);
-        dict_add(dictionary, Pm, nextIndex, size_j + size_k);
-        if (max_pattern_size < (size_j + size_k)) {
+        if (dict_add(dictionary, Pm, nextIndex, size_j + size_k) && max_pattern_size < (size_j + size_k)) {
             max_pattern_size = size_j + size_k;
 
             int *new_Pj = realloc(Pj, max_pattern_size * sizeof(int));
@@ -370,17 +497,29 @@ int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out) {
         }
         nextIndex++;
 
+        last_idx_k = idx_k;
+
         // if dict full, clear and start from 256
-        if (nextIndex == DICT_SIZE) {
+        if (nextIndex == dict_size) {
+            if (resets)
+                (*resets)++;
             dict_free(dictionary);
             free(dictionary);
             nextIndex = 256;
             dictionary = create_dict();
+            size_j = 0;
+            idx_j = -1;
+        } else {
+            // Pk becomes the next Pj
+            int *temp = Pj;
+            Pj = Pk;
+            Pk = temp;
+            size_j = size_k;
+            idx_j = idx_k;
         }
 
-        size_j = size_k = 0;
-        last_idx_k = idx_k;
-        idx_j = idx_k = -1;
+        size_k = 0;
+        idx_k = -1;
     } while (N < nbytes);
 
     buffer_out[M] = last_idx_k;
@@ -397,7 +536,7 @@ int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out) {
     return M;
 }
 
-int lzw_encode(int *buffer_in, int nbytes, int *buffer_out) {
+int lzw_encode(int *buffer_in, int nbytes, int *buffer_out, int *resets) {
     // print buffer de entrada
     if (textflag || debugflag) {
         printf("buffer_in (lzw_encode):\n");
@@ -444,10 +583,10 @@ int lzw_encode(int *buffer_in, int nbytes, int *buffer_out) {
             if (p_idx == -1) {
                 N--;
                 /*save pattern in dict*/
-                dict_add(dictionary, pattern, nextIndex, p_size);
+                int kept = dict_add(dictionary, pattern, nextIndex, p_size);
 
                 /*extend allocated memory for buffer according to longest pattern in dictionary*/
-                if (max_pattern_size < p_size + 1) {
+                if (kept && max_pattern_size < p_size + 1) {
                     max_pattern_size = p_size + 1;
 
                     int *p_temp = realloc(pattern, max_pattern_size * sizeof(int));
@@ -463,7 +602,9 @@ int lzw_encode(int *buffer_in, int nbytes, int *buffer_out) {
             }
         }
         // if dict full, clear and start from 256
-        if (nextIndex == DICT_SIZE) {
+        if (nextIndex == dict_size) {
+            if (resets)
+                (*resets)++;
             dict_free(dictionary);
             free(dictionary);
             nextIndex = 256;
@@ -481,4 +622,123 @@ int lzw_encode(int *buffer_in, int nbytes, int *buffer_out) {
     free(dictionary);
     free(pattern);
     return M;
-};
\ No newline at end of file
+}
+
+/**
+ * Encode a given buffer of bytes using LZWD algorithm with flexible parsing.
+ * Pj is always the Pk chosen in the previous step. Pk is chosen among the longest patterns at
+ * its position, picking the one that lets the next pattern reach furthest. parse_level sets how
+ * many shorter candidates are tried (all of them at PARSE_LEVEL_MAX).
+ * Output is decoded exactly like the one from lzwd_encode.
+ * @param buffer_in buffer to read from
+ * @param buffer_out buffer to write to
+ * @param nbytes number of bytes to process from buffer_in
+ * @param resets if not NULL, incremented every time the dictionary is full and cleared
+ *
+ * @returns number of bytes written to buffer_out
+ **/
+int lzwd_encode_flexible(int *buffer_in, int nbytes, int *buffer_out, int *resets) {
+    byte *input = (byte *)buffer_in;
+    int N = 0; // apontador de leitura do bloco
+    int M = 0; // apontador de escrita do output
+    int nextIndex = 256;
+    dict *dictionary = create_dict();
+
+    if (debugflag)
+        printf(DEBUG_TXT "%s" RESET_TXT, "Dictionary Initializated (flexible parsing).\n");
+
+    int max_pattern_size = 1;
+    int *Pj = malloc(1 * sizeof(int));
+    int *Pk = malloc(1 * sizeof(int));
+    int *Pm = malloc(2 * sizeof(int));
+    int *scratch = malloc(1 * sizeof(int));
+
+    // first Pj is the longest pattern at the start of the block
+    int idx_j, idx_k;
+    int size_j = dict_longest_pattern(dictionary, input, nbytes, max_pattern_size, Pj, &idx_j);
+
+    while (N + size_j < nbytes) {
+        int pos_k = N + size_j;
+        int available = nbytes - pos_k;
+
+        // try Pk candidates from longest to shortest, keep the one reaching furthest
+        int best_score = -1, size_k = 0, tried = 0;
+        idx_k = -1;
+        int size = available < max_pattern_size ? available : max_pattern_size;
+        for (; size > 0 && (parse_level >= PARSE_LEVEL_MAX || tried <= parse_level); size--) {
+            for (int i = 0; i < size; i++) {
+                scratch[i] = input[pos_k + i];
+            }
+            int idx = dict_get_value(dictionary, scratch, size);
+            if (idx == -1)
+                continue;
+            tried++;
+
+            int next_idx;
+            int score = size + dict_longest_pattern(dictionary, input + pos_k + size, available - size,
+                                                    max_pattern_size, scratch, &next_idx);
+            if (score > best_score) {
+                best_score = score;
+                size_k = size;
+                idx_k = idx;
+            }
+        }
+        for (int i = 0; i < size_k; i++) {
+            Pk[i] = input[pos_k + i];
+        }
+
+        if (debugflag) {
+            printf("::Pj-> %d (%d symbols) ::Pk-> %d (%d symbols)\n", idx_j, size_j, idx_k, size_k);
+        }
+
+        // add pattern Pm(Pj+Pk) to dict
+        concat_pattern(Pj, size_j, Pk, size_k, Pm);
+        if (dict_add(dictionary, Pm, nextIndex, size_j + size_k) && max_pattern_size < (size_j + size_k)) {
+            max_pattern_size = size_j + size_k;
+            Pj = realloc(Pj, max_pattern_size * sizeof(int));
+            Pk = realloc(Pk, max_pattern_size * sizeof(int));
+            Pm = realloc(Pm, 2 * max_pattern_size * sizeof(int));
+            scratch = realloc(scratch, max_pattern_size * sizeof(int));
+        }
+        // save Pj index to output
+        buffer_out[M] = idx_j;
+        M++;
+        if (debugflag) {
+            printf("::OUT-> %d \n", idx_j);
+        }
+        nextIndex++;
+        N = pos_k;
+
+        // if dict full, clear and start from 256. Pk has to be searched again in the new dictionary
+        if (nextIndex == dict_size) {
+            if (resets)
+                (*resets)++;
+            dict_free(dictionary);
+            free(dictionary);
+            nextIndex = 256;
+            dictionary = create_dict();
+            size_j = dict_longest_pattern(dictionary, input + N, nbytes - N, max_pattern_size, Pj, &idx_j);
+        } else {
+            // Pk becomes the next Pj
+            int *temp = Pj;
+            Pj = Pk;
+            Pk = temp;
+            size_j = size_k;
+            idx_j = idx_k;
+        }
+    }
+
+    buffer_out[M] = idx_j;
+    M++;
+
+    if (debugflag)
+        dict_print(dictionary);
+
+    dict_free(dictionary);
+    free(dictionary);
+    free(Pj);
+    free(Pk);
+    free(Pm);
+    free(scratch);
+    return M;
+}
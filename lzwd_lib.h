@@ -9,15 +9,22 @@
 
 // DEFINES
 #define BLOCK_SIZE_DEFAULT 64000
+#define BLOCK_SIZE_MIN 64000 // smallest block size picked by -s auto
 #define DEBUG_TXT "\x1b[33m"
 #define RESET_TXT "\x1b[0m"
-#define USAGE_MSG "Usage: ./lzwd <filename-to-compress> [options]\nOptions:\n -d: debug mode\n -f: force rle encoding\n -s <block size>: reading block size. MIN: 64Kb\n"
+#define USAGE_MSG "Usage: ./lzwd <filename-to-compress>... [options]\nOptions:\n -d: debug mode\n -f: force rle encoding\n -s <block size|auto>: reading block size in bytes (default 64000), auto picks it (64000 or more) and the dictionary size from samples of every file\n -l <level>: parsing level of lzwd, 0 (greedy) to 9 (full flexible parsing). lzw only parses greedily\n -e: entropy code the output indexes\n -D: write repeated blocks as a reference to the first one (also across files)\n -a: append the blocks to the existing compressed file\n -o <archive>: compress every file into archive instead of one named after it (appended to it with -a)\n -r: resume an interrupted compression from its last complete block (with -a, an interrupted append), start a new file if there is none\n -M <limit>: use at most limit bytes of memory (K, M or G suffix), blocks and dictionary patterns are sized to fit\n"
 #define DICT_SIZE 4096
+#define DICT_SIZE_MIN 1024 // smallest dictionary tried by -s auto
+#define PARSE_LEVEL_MAX 9
 
 extern int debugflag;
 extern int sizeflag;
 extern int textflag;
 extern int lzwflag;
+extern int parse_level;
+extern int dict_size;
+extern int dict_key_max; // bytes of patterns a dictionary keeps, 0 for no limit
+extern int pattern_max;  // longest pattern a dictionary keeps, 0 for no limit
 
 #include <getopt.h> //for cmd arguments parsing
 #include <stdio.h>
@@ -30,7 +37,7 @@ typedef unsigned char byte; // from 0 to 255
 
 // entrada no dicionario
 typedef struct d_entry {
-    int *key;             // pattern
+    int key;              // pattern, offset in keys of the dictionary (-1 if not kept, never matches)
     int value;            // pattern index in dictionary
     int length;           // pattern size
     struct d_entry *next; // next pattern pointer (for collisions)
@@ -39,21 +46,36 @@ typedef struct d_entry {
 // dicionario
 typedef struct dict {
     d_entry **entries;
+    d_entry *nodes;    // room for DICT_SIZE entries, taken in order
+    int nnodes;
+    byte *keys;        // patterns of all entries, one after the other
+    int keys_size;     // bytes used
+    int keys_capacity; // bytes allocated
 } dict;
 
 int hash(int *key, int size);
 dict *create_dict();
-d_entry *map_pair(int *key, int value, int size);
-void dict_add(dict *dictionary, int *key, int value, int size);
+d_entry *map_pair(dict *dictionary, int *key, int value, int size);
+int dict_add(dict *dictionary, int *key, int value, int size);
 int dict_get_value(dict *dictionary, int *key, int size);
 
 void dict_print(dict *dictionary);
 void dict_free(dict *dictionary);
 
 int compare_pattern(int *pattern_x, int size_x, int *pattern_y, int size_y);
+int compare_key(int *pattern, byte *key, int size);
 void concat_pattern(int *pattern_x, int size_x, int *pattern_y, int size_y, int *result);
 
-int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out);
-int lzw_encode(int *buffer_in, int nbytes, int *buffer_out);
+int dict_longest_prefix(dict *dictionary, byte *buffer, int nbytes, int *pattern, int *idx_by_size);
+int dict_longest_pattern(dict *dictionary, byte *buffer, int nbytes, int max_size, int *pattern, int *idx);
+
+long long dict_memory();
+
+void put_u32(byte *out, unsigned int value);
+unsigned int get_u32(byte *in);
+
+int lzwd_encode(int *buffer_in, int nbytes, int *buffer_out, int *resets);
+int lzw_encode(int *buffer_in, int nbytes, int *buffer_out, int *resets);
+int lzwd_encode_flexible(int *buffer_in, int nbytes, int *buffer_out, int *resets);
 
 #endif
\ No newline at end of file
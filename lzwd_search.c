@@ -0,0 +1,369 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#include "lzwd_search.h"
+#include "lzwd_file.h"
+
+/**
+ * Creates the search automaton (KMP) of a pattern.
+ * @param pattern symbols to search
+ * @param length pattern size (1 to SEARCH_PATTERN_MAX)
+ *
+ * @return Pointer to newly created automaton.
+ **/
+pattern_dfa *create_dfa(byte *pattern, int length) {
+    pattern_dfa *dfa = malloc(sizeof(pattern_dfa));
+    dfa->pattern = malloc(length);
+    memcpy(dfa->pattern, pattern, length);
+    dfa->length = length;
+    dfa->next = malloc(sizeof(int) * 256 * (length + 1));
+
+    for (int b = 0; b < 256; b++) {
+        dfa->next[b] = 0;
+    }
+    dfa->next[pattern[0]] = 1;
+
+    // border: state reached by the pattern without its first symbol
+    int border = 0;
+    for (int state = 1; state <= length; state++) {
+        for (int b = 0; b < 256; b++) {
+            dfa->next[state * 256 + b] = dfa->next[border * 256 + b];
+        }
+        if (state < length) {
+            dfa->next[state * 256 + pattern[state]] = state + 1;
+            border = dfa->next[border * 256 + pattern[state]];
+        }
+    }
+    return dfa;
+}
+
+/**
+ * Frees a search automaton.
+ * @param dfa pointer to automaton to free
+ **/
+void dfa_free(pattern_dfa *dfa) {
+    free(dfa->pattern);
+    free(dfa->next);
+    free(dfa);
+}
+
+/**
+ * Writes the first symbols of a phrase, walking its nodes left to right.
+ * @param table table of phrases
+ * @param node phrase to expand
+ * @param out where to write the symbols
+ * @param limit maximum number of symbols to write
+ *
+ * @return number of symbols written
+ **/
+static int expand_node(phrase_table *table, int node, byte *out, int limit) {
+    int *stack = table->stack;
+    int top = 0, written = 0;
+    stack[top++] = node;
+    while (top > 0 && written < limit) {
+        phrase_node *n = &table->nodes[stack[--top]];
+        if (n->left < 0) {
+            out[written++] = n->first;
+        } else {
+            stack[top++] = n->right;
+            stack[top++] = n->left;
+        }
+    }
+    return written;
+}
+
+/**
+ * Adds a phrase node made of two other phrases, working out its search state without expanding it.
+ * Only the first dfa->length symbols of right have to be read: after that many symbols the state
+ * no longer depends on where reading started.
+ * @return id of the new node, -1 if phrase is longer than the block
+ **/
+static int add_node(phrase_table *table, pattern_dfa *dfa, int left, int right) {
+    phrase_node *l = &table->nodes[left];
+    phrase_node *r = &table->nodes[right];
+    if (l->length + r->length > table->raw_size)
+        return -1;
+
+    int id = table->nnodes++;
+    phrase_node *n = &table->nodes[id];
+    n->left = left;
+    n->right = right;
+    n->length = l->length + r->length;
+    n->first = l->first;
+    n->last = r->last;
+    n->match = l->match || r->match;
+    n->newline = l->newline || r->newline;
+
+    int state = l->state;
+    int count = expand_node(table, right, table->scratch, dfa->length);
+    for (int i = 0; i < count; i++) {
+        state = dfa->next[state * 256 + table->scratch[i]];
+        if (state == dfa->length)
+            n->match = 1;
+    }
+    n->state = count < r->length ? r->state : state;
+    return id;
+}
+
+/**
+ * Rebuilds the phrase of every index in a block, keeping only the metadata needed to search it
+ * (first and last symbol, size, links to the phrases it was made of).
+ * Mirrors the dictionary of lzw_encode / lzwd_encode, including clearing it when full.
+ * @param algorithm ALGO_LZW or ALGO_LZWD
+ * @param dict_size dictionary entries before it is cleared
+ * @param codes dictionary indexes of the block
+ * @param ncodes number of indexes
+ * @param raw_size number of source bytes in the block
+ * @param dfa automaton of the pattern to search
+ *
+ * @return Pointer to table of phrases, NULL if indexes don't make a valid block
+ **/
+phrase_table *build_phrases(int algorithm, int dict_size, int *codes, int ncodes, int raw_size, pattern_dfa *dfa) {
+    phrase_table *table = malloc(sizeof(phrase_table));
+    table->nodes = malloc(sizeof(phrase_node) * (256 + ncodes));
+    table->phrases = malloc(sizeof(int) * (ncodes + 1));
+    table->offsets = malloc(sizeof(int) * (ncodes + 1));
+    table->stack = malloc(sizeof(int) * (raw_size + 2));
+    table->scratch = malloc(raw_size + 1);
+    table->nphrases = ncodes;
+    table->raw_size = raw_size;
+    table->nnodes = 256;
+
+    // single symbol phrases
+    for (int b = 0; b < 256; b++) {
+        phrase_node *n = &table->nodes[b];
+        n->left = n->right = -1;
+        n->length = 1;
+        n->first = n->last = b;
+        n->state = dfa->next[b];
+        n->match = n->state == dfa->length;
+        n->newline = b == '\n';
+    }
+
+    int map[DICT_SIZE]; // dictionary index -> node
+    for (int i = 0; i < 256; i++) {
+        map[i] = i;
+    }
+    int nextIndex = 256;
+    int prev = -1;
+    int offset = 0;
+
+    for (int i = 0; i < ncodes; i++) {
+        int code = codes[i];
+        int cur;
+        if (code < 0 || code > nextIndex || (code == nextIndex && (algorithm != ALGO_LZW || prev == -1))) {
+            phrases_free(table);
+            return NULL;
+        }
+
+        if (algorithm == ALGO_LZW) {
+            // new entry is previous phrase + first symbol of this one
+            if (prev != -1) {
+                int first = code < nextIndex ? table->nodes[map[code]].first : table->nodes[prev].first;
+                int id = add_node(table, dfa, prev, first);
+                if (id == -1) {
+                    phrases_free(table);
+                    return NULL;
+                }
+                map[nextIndex++] = id;
+            }
+            cur = map[code];
+        } else {
+            // new entry is previous phrase + this one
+            cur = map[code];
+            if (prev != -1) {
+                int id = add_node(table, dfa, prev, cur);
+                if (id == -1) {
+                    phrases_free(table);
+                    return NULL;
+                }
+                map[nextIndex++] = id;
+            }
+        }
+
+        table->phrases[i] = cur;
+        table->offsets[i] = offset;
+        offset += table->nodes[cur].length;
+        if (offset > raw_size) {
+            phrases_free(table);
+            return NULL;
+        }
+        prev = cur;
+
+        // same points where the encoders clear their dictionary
+        if (algorithm == ALGO_LZW && nextIndex == dict_size - 1) {
+            nextIndex = 256;
+            prev = -1;
+        } else if (algorithm == ALGO_LZWD && nextIndex == dict_size) {
+            nextIndex = 256;
+        }
+    }
+    table->offsets[ncodes] = offset;
+
+    if (offset != raw_size) {
+        phrases_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+/**
+ * Searches the pattern in a block. Phrases are only expanded when the pattern may cross into
+ * them (first dfa->length symbols) or is known to be inside them.
+ * @param table table of phrases of the block
+ * @param dfa automaton of the pattern
+ * @param hits where to save the offset in block of every match (room for raw_size entries)
+ *
+ * @return number of matches
+ **/
+int search_phrases(phrase_table *table, pattern_dfa *dfa, int *hits) {
+    int nhits = 0;
+    int state = 0;
+    int m = dfa->length;
+
+    for (int i = 0; i < table->nphrases; i++) {
+        phrase_node *n = &table->nodes[table->phrases[i]];
+        int offset = table->offsets[i];
+
+        if (state != 0) {
+            // matches that started in previous phrases
+            int count = expand_node(table, table->phrases[i], table->scratch, m);
+            for (int j = 0; j < count; j++) {
+                state = dfa->next[state * 256 + table->scratch[j]];
+                if (state == m && j < m - 1)
+                    hits[nhits++] = offset + j - m + 1;
+            }
+            if (count < n->length)
+                state = n->state;
+        } else {
+            state = n->state;
+        }
+
+        // matches inside the phrase
+        if (n->match) {
+            int count = expand_node(table, table->phrases[i], table->scratch, n->length);
+            int inner = 0;
+            for (int j = 0; j < count; j++) {
+                inner = dfa->next[inner * 256 + table->scratch[j]];
+                if (inner == m)
+                    hits[nhits++] = offset + j - m + 1;
+            }
+        }
+    }
+    return nhits;
+}
+
+/**
+ * Finds the phrase holding a symbol of the block.
+ * @param table table of phrases of the block
+ * @param offset offset in block of the symbol
+ *
+ * @return position of the last phrase starting at or before offset
+ **/
+static int find_phrase(phrase_table *table, int offset) {
+    int low = 0, high = table->nphrases - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (table->offsets[mid] <= offset)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+/**
+ * Expands part of a block.
+ * @param table table of phrases of the block
+ * @param start offset in block of first symbol
+ * @param length number of symbols to expand
+ * @param out where to write the symbols
+ *
+ * @return number of symbols written (less than length at the end of the block)
+ **/
+int expand_range(phrase_table *table, int start, int length, byte *out) {
+    if (start < 0 || start >= table->raw_size || length <= 0)
+        return 0;
+    if (start + length > table->raw_size)
+        length = table->raw_size - start;
+
+    int written = 0;
+    for (int i = find_phrase(table, start); i < table->nphrases && written < length; i++) {
+        int skip = start + written - table->offsets[i];
+        int count = expand_node(table, table->phrases[i], table->scratch, skip + length - written);
+        memcpy(out + written, table->scratch + skip, count - skip);
+        written += count - skip;
+    }
+    return written;
+}
+
+/**
+ * Finds the first newline of a block at or after an offset. Only phrases with a newline are expanded.
+ * @param table table of phrases of the block
+ * @param start offset in block where to start looking
+ *
+ * @return offset in block of the newline, -1 if there is none
+ **/
+int next_newline(phrase_table *table, int start) {
+    if (start < 0)
+        start = 0;
+    if (start >= table->raw_size)
+        return -1;
+
+    for (int i = find_phrase(table, start); i < table->nphrases; i++) {
+        phrase_node *n = &table->nodes[table->phrases[i]];
+        if (!n->newline)
+            continue;
+        int count = expand_node(table, table->phrases[i], table->scratch, n->length);
+        int j = start > table->offsets[i] ? start - table->offsets[i] : 0;
+        for (; j < count; j++) {
+            if (table->scratch[j] == '\n')
+                return table->offsets[i] + j;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Finds the last newline of a block before an offset. Only phrases with a newline are expanded.
+ * @param table table of phrases of the block
+ * @param end offset in block where to stop looking (not included)
+ *
+ * @return offset in block of the newline, -1 if there is none
+ **/
+int prev_newline(phrase_table *table, int end) {
+    if (end > table->raw_size)
+        end = table->raw_size;
+    if (end <= 0)
+        return -1;
+
+    for (int i = find_phrase(table, end - 1); i >= 0; i--) {
+        phrase_node *n = &table->nodes[table->phrases[i]];
+        if (!n->newline)
+            continue;
+        int count = expand_node(table, table->phrases[i], table->scratch, n->length);
+        if (count > end - table->offsets[i])
+            count = end - table->offsets[i];
+        for (int j = count - 1; j >= 0; j--) {
+            if (table->scratch[j] == '\n')
+                return table->offsets[i] + j;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Frees a table of phrases.
+ * @param table pointer to table to free
+ **/
+void phrases_free(phrase_table *table) {
+    free(table->nodes);
+    free(table->phrases);
+    free(table->offsets);
+    free(table->stack);
+    free(table->scratch);
+    free(table);
+}
@@ -0,0 +1,56 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (LZWd algorithm)
+ **/
+
+#ifndef LZWD_SEARCH
+#define LZWD_SEARCH
+
+#include "lzwd_lib.h"
+
+// DEFINES
+#define SEARCH_PATTERN_MAX 1024 // longest pattern that can be searched
+
+// automato de pesquisa (KMP) do padrao
+typedef struct pattern_dfa {
+    byte *pattern;
+    int length;
+    int *next; // next state for every (state, symbol): next[state * 256 + symbol]. State length means match
+} pattern_dfa;
+
+// no da tabela de frases: a frase e a concatenacao das frases left e right
+typedef struct phrase_node {
+    int left;    // -1 for single symbol phrases
+    int right;   // -1 for single symbol phrases
+    int length;  // phrase size
+    byte first;  // first symbol of phrase
+    byte last;   // last symbol of phrase
+    int state;   // search state after reading the phrase from state 0
+    int match;   // if true the pattern is fully inside the phrase
+    int newline; // if true the phrase has a '\n'
+} phrase_node;
+
+// tabela de frases de um bloco, sem expandir os simbolos
+typedef struct phrase_table {
+    phrase_node *nodes;
+    int nnodes;
+    int *phrases; // node of every index in the block
+    int *offsets; // offset in block of every index
+    int nphrases;
+    int raw_size; // size of the block once expanded
+    int *stack;   // work space for expanding phrases
+    byte *scratch;
+} phrase_table;
+
+pattern_dfa *create_dfa(byte *pattern, int length);
+void dfa_free(pattern_dfa *dfa);
+
+phrase_table *build_phrases(int algorithm, int dict_size, int *codes, int ncodes, int raw_size, pattern_dfa *dfa);
+int search_phrases(phrase_table *table, pattern_dfa *dfa, int *hits);
+int expand_range(phrase_table *table, int start, int length, byte *out);
+int next_newline(phrase_table *table, int start);
+int prev_newline(phrase_table *table, int end);
+void phrases_free(phrase_table *table);
+
+#endif
@@ -0,0 +1,487 @@
+/**
+ * author: shadolaptop
+ * created: 18-03-2022
+ * project: File compression (search in compressed files)
+ **/
+
+#include "lzwd_file.h"
+#include "lzwd_search.h"
+#include <pthread.h>
+
+#define GREP_USAGE_MSG "Usage: ./lzwgrep <pattern> <compressed-file> [options]\nOptions:\n -d: debug mode\n -c: only print number of matching lines\n -b: print source offset before every line\n -j <threads>: number of search threads\n"
+
+int debugflag = 0; // if true use debug moode
+int sizeflag = 0;  // unused, needed by lzwd_lib
+int textflag = 0;  // unused, needed by lzwd_lib
+int parse_level = 0;
+int dict_size = DICT_SIZE; // unused, every file says its own
+int dict_key_max = 0;
+int pattern_max = 0;
+int entropyflag = 0;
+int countflag = 0;  // if true only count matching lines
+int offsetflag = 0; // if true print offset of every line
+
+// parte de uma linha com pelo menos uma ocorrencia que esta dentro de um bloco
+typedef struct match_line {
+    long long start; // offset in source of first symbol of line in this block
+    int length;
+    byte *text;      // NULL with -c
+    int open_left;   // line starts in a previous block
+    int open_right;  // line ends in a next block
+} match_line;
+
+// bloco do ficheiro comprimido e resultado da pesquisa nele
+typedef struct block_job {
+    block_header header;
+    long file_pos;     // position of payload in compressed file
+    long long offset;  // offset of block in source
+    match_line *lines;
+    int nlines;
+    byte *head; // first symbols of block, to find matches across blocks
+    byte *tail; // last symbols of block
+    int head_size, tail_size;
+    int first_newline; // offset in block of first newline, -1 if none
+    int last_newline;  // offset in block of last newline, -1 if none
+    int failed;
+} block_job;
+
+// estado partilhado pelas threads
+typedef struct search_state {
+    char *file_name;
+    file_header header;
+    pattern_dfa *dfa;
+    block_job *jobs;
+    int next_job;
+    int context; // size of head and tail kept for every block
+    pthread_mutex_t lock;
+} search_state;
+
+// bloco expandido pela thread principal para escrever partes de linhas de outros blocos
+typedef struct block_reader {
+    FILE *file;
+    int block; // block of table, -1 if none
+    phrase_table *table;
+} block_reader;
+
+/**
+ * Reads the indexes of a block. Reference blocks are read from the block they point to.
+ * @param state shared search state
+ * @param file compressed file opened by the calling thread
+ * @param job block to read
+ * @param format where to save the header of the file that encoded the indexes (algorithm and dictionary)
+ *
+ * @return newly allocated indexes (job->header.ncodes updated), NULL on error
+ **/
+int *read_job_codes(search_state *state, FILE *file, block_job *job, file_header *format) {
+    FILE *source = file; // file holding the indexes
+    block_header header = job->header;
+    *format = state->header;
+    if (fseek(file, job->file_pos, SEEK_SET) != 0)
+        return NULL;
+
+    if (header.method == METHOD_REF) {
+        block_ref ref;
+        if (read_block_ref(file, &header, &ref) != 0)
+            return NULL;
+        if (ref.archive[0]) {
+            char *path = ref_archive_path(state->file_name, ref.archive);
+            source = fopen(path, "rb");
+            free(path);
+            if (!source)
+                return NULL;
+            if (read_file_header(source, format) != 0) {
+                fclose(source);
+                return NULL;
+            }
+        }
+        if (seek_block(source, ref.block, &header) != 0 || header.method == METHOD_REF ||
+            header.raw_size != job->header.raw_size) {
+            if (source != file)
+                fclose(source);
+            return NULL;
+        }
+        if (debugflag)
+            printf(DEBUG_TXT "Block at %lld repeats block %d of %s.\n" RESET_TXT, job->offset, ref.block + 1,
+                   ref.archive[0] ? ref.archive : state->file_name);
+    }
+
+    int *codes = malloc(sizeof(int) * (header.ncodes + 1));
+    if (read_block_codes(source, &header, codes) != 0) {
+        free(codes);
+        codes = NULL;
+    }
+    job->header.ncodes = header.ncodes;
+    if (source != file)
+        fclose(source);
+    return codes;
+}
+
+/**
+ * Reads and rebuilds the phrases of a block.
+ * @param state shared search state
+ * @param file compressed file opened by the calling thread
+ * @param job block to read
+ *
+ * @return Pointer to table of phrases, NULL on error
+ **/
+phrase_table *load_block(search_state *state, FILE *file, block_job *job) {
+    file_header format;
+    int *codes = read_job_codes(state, file, job, &format);
+    if (!codes)
+        return NULL;
+    phrase_table *table = build_phrases(format.algorithm, format.dict_size, codes, job->header.ncodes, job->header.raw_size, state->dfa);
+    free(codes);
+    return table;
+}
+
+/**
+ * Searches one block and saves the part in it of every matching line, its head, tail and newlines.
+ * Lines are read up to the next newline or the limit of the block, however long they are.
+ * @param state shared search state
+ * @param file compressed file opened by the calling thread
+ * @param job block to search
+ **/
+void search_block(search_state *state, FILE *file, block_job *job) {
+    phrase_table *table = load_block(state, file, job);
+    if (!table) {
+        job->failed = 1;
+        return;
+    }
+
+    int raw_size = job->header.raw_size;
+    job->head = malloc(state->context + 1);
+    job->tail = malloc(state->context + 1);
+    job->head_size = expand_range(table, 0, state->context, job->head);
+    job->tail_size = raw_size < state->context ? raw_size : state->context;
+    expand_range(table, raw_size - job->tail_size, job->tail_size, job->tail);
+    job->first_newline = next_newline(table, 0);
+    job->last_newline = prev_newline(table, raw_size);
+
+    int *hits = malloc(sizeof(int) * (raw_size + 1));
+    int nhits = search_phrases(table, state->dfa, hits);
+    if (debugflag)
+        printf(DEBUG_TXT "Block at %lld: %d indexes, %d matches.\n" RESET_TXT, job->offset, job->header.ncodes, nhits);
+
+    // only the lines with matches are expanded
+    job->lines = malloc(sizeof(match_line) * (nhits + 1));
+    int line_end = -1;
+    for (int h = 0; h < nhits; h++) {
+        if (hits[h] < line_end)
+            continue; // same line as previous match
+
+        int first = prev_newline(table, hits[h]) + 1;
+        int last = next_newline(table, hits[h]);
+        match_line *line = &job->lines[job->nlines++];
+        line->open_left = first == 0;
+        line->open_right = last == -1;
+        if (last == -1)
+            last = raw_size;
+        line->start = job->offset + first;
+        line->length = last - first;
+        line->text = NULL;
+        if (!countflag) {
+            line->text = malloc(line->length + 1);
+            expand_range(table, first, line->length, line->text);
+        }
+        line_end = last;
+    }
+
+    free(hits);
+    phrases_free(table);
+}
+
+/**
+ * Search thread. Takes blocks from the shared list until none are left.
+ * @param arg shared search state
+ **/
+void *search_thread(void *arg) {
+    search_state *state = arg;
+    FILE *file = fopen(state->file_name, "rb");
+
+    while (file) {
+        pthread_mutex_lock(&state->lock);
+        int idx = state->next_job++;
+        pthread_mutex_unlock(&state->lock);
+        if (idx >= state->header.block_count)
+            break;
+        search_block(state, file, &state->jobs[idx]);
+    }
+
+    if (file)
+        fclose(file);
+    return NULL;
+}
+
+/**
+ * Finds where the line holding the end of a block starts.
+ * @param state shared search state
+ * @param block index of the block
+ *
+ * @return offset in source of the line
+ **/
+long long line_start(search_state *state, int block) {
+    for (int i = block; i >= 0; i--) {
+        block_job *job = &state->jobs[i];
+        if (job->last_newline != -1)
+            return job->offset + job->last_newline + 1;
+    }
+    return 0;
+}
+
+/**
+ * Finds where the line holding the start of a block ends. Stops at corrupted blocks.
+ * @param state shared search state
+ * @param block index of the block
+ *
+ * @return offset in source of the newline ending the line (or of the end of the source)
+ **/
+long long line_end(search_state *state, int block) {
+    for (int i = block; i < state->header.block_count; i++) {
+        block_job *job = &state->jobs[i];
+        if (job->failed)
+            return job->offset;
+        if (job->first_newline != -1)
+            return job->offset + job->first_newline;
+    }
+    block_job *last = &state->jobs[state->header.block_count - 1];
+    return state->header.block_count > 0 ? last->offset + last->header.raw_size : 0;
+}
+
+/**
+ * Writes part of the source, expanding the blocks holding it. The last block expanded is kept.
+ * @param state shared search state
+ * @param reader block expanded last, updated
+ * @param start offset in source of first symbol
+ * @param end offset in source after last symbol
+ **/
+void write_source(search_state *state, block_reader *reader, long long start, long long end) {
+    // last block starting at or before start
+    int low = 0, high = state->header.block_count - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (state->jobs[mid].offset <= start)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    for (int i = low; i < state->header.block_count && start < end; i++) {
+        block_job *job = &state->jobs[i];
+        long long block_end = job->offset + job->header.raw_size;
+        if (block_end <= start)
+            continue;
+        if (reader->block != i) {
+            if (reader->table)
+                phrases_free(reader->table);
+            reader->table = job->failed ? NULL : load_block(state, reader->file, job);
+            reader->block = i;
+        }
+        if (!reader->table)
+            return;
+
+        int length = (end < block_end ? end : block_end) - start;
+        byte *out = malloc(length);
+        int count = expand_range(reader->table, start - job->offset, length, out);
+        fwrite(out, 1, count, stdout);
+        free(out);
+        start += length;
+    }
+}
+
+/**
+ * Prints a matching line, unless it was already printed. Parts of the line in other blocks are
+ * expanded from them.
+ * @param state shared search state
+ * @param reader block expanded last, updated
+ * @param block index of the block holding the part of the line
+ * @param line part of the line in the block
+ * @param last_start start of last line printed, updated
+ * @return 1 if line was printed (or counted), 0 otherwise
+ **/
+int print_line(search_state *state, block_reader *reader, int block, match_line *line, long long *last_start) {
+    long long start = line->open_left ? line_start(state, block - 1) : line->start;
+    if (start <= *last_start)
+        return 0;
+    *last_start = start;
+    if (countflag)
+        return 1;
+    if (offsetflag)
+        printf("%lld:", start);
+    write_source(state, reader, start, line->start);
+    if (line->text)
+        fwrite(line->text, 1, line->length, stdout);
+    else
+        write_source(state, reader, line->start, line->start + line->length);
+    if (line->open_right)
+        write_source(state, reader, line->start + line->length, line_end(state, block + 1));
+    printf("\n");
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+
+    clock_t t_start = clock(), t_end; // clocks for executing time calculations
+    int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // 1. read and interpret the input
+    int opt;
+    while ((opt = getopt(argc, argv, "dcbj:")) != -1) {
+        switch (opt) {
+        case 'd':
+            debugflag = 1;
+            printf(DEBUG_TXT "Program iniciated in debug mode.\n" RESET_TXT);
+            break;
+        case 'c':
+            countflag = 1;
+            break;
+        case 'b':
+            offsetflag = 1;
+            break;
+        case 'j':
+            nthreads = atoi(optarg);
+            break;
+        case '?':
+            printf("%s\n", GREP_USAGE_MSG);
+            return 1;
+        default:
+            abort();
+        }
+    }
+    if (argc - optind != 2) {
+        printf("%s\n", GREP_USAGE_MSG);
+        return 1;
+    }
+    if (nthreads < 1)
+        nthreads = 1;
+
+    int pattern_size = strlen(argv[optind]);
+    if (pattern_size < 1 || pattern_size > SEARCH_PATTERN_MAX) {
+        printf("Pattern must have 1 to %d bytes.\n", SEARCH_PATTERN_MAX);
+        return 1;
+    }
+    if (memchr(argv[optind], '\n', pattern_size)) {
+        printf("Pattern can't have a newline.\n");
+        return 1;
+    }
+
+    // 2. OPEN compressed file and index its blocks
+    search_state state;
+    state.file_name = argv[optind + 1];
+    FILE *file = fopen(state.file_name, "rb");
+    if (!file) {
+        printf("Unable to open supplied file.\n");
+        return 1;
+    }
+    if (read_file_header(file, &state.header) != 0) {
+        printf("Not a compressed file.\n");
+        fclose(file);
+        return 1;
+    }
+
+    state.jobs = calloc(state.header.block_count + 1, sizeof(block_job));
+    long long offset = 0;
+    for (int i = 0; i < state.header.block_count; i++) {
+        block_job *job = &state.jobs[i];
+        if (read_block_header(file, &job->header) != 0) {
+            printf("Compressed file is truncated or corrupted.\n");
+            fclose(file);
+            free(state.jobs);
+            return 1;
+        }
+        job->file_pos = ftell(file);
+        job->offset = offset;
+        offset += job->header.raw_size;
+        fseek(file, job->header.payload_size, SEEK_CUR);
+    }
+    fclose(file);
+
+    // 3. search blocks in parallel
+    state.dfa = create_dfa((byte *)argv[optind], pattern_size);
+    state.next_job = 0;
+    state.context = pattern_size - 1;
+    pthread_mutex_init(&state.lock, NULL);
+
+    pthread_t *threads = malloc(sizeof(pthread_t) * nthreads);
+    for (int t = 0; t < nthreads; t++) {
+        pthread_create(&threads[t], NULL, search_thread, &state);
+    }
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    // 4. search matches across blocks, print lines in order
+    int nlines = 0, status = 0;
+    long long last_start = -1;
+    byte *joined = malloc(2 * state.context + 1);
+    byte *carry = malloc(state.context + 1);
+    int carry_size = 0;
+    block_reader reader = {fopen(state.file_name, "rb"), -1, NULL};
+
+    for (int i = 0; i < state.header.block_count; i++) {
+        block_job *job = &state.jobs[i];
+        if (job->failed || !reader.file) {
+            printf("Block %d is corrupted.\n", i + 1);
+            status = 1;
+            break;
+        }
+
+        // matches starting in previous blocks and ending in this one: their line crosses the block start
+        memcpy(joined, carry, carry_size);
+        memcpy(joined + carry_size, job->head, job->head_size);
+        int joined_size = carry_size + job->head_size;
+        int search = 0;
+        for (int j = 0; j < joined_size; j++) {
+            search = state.dfa->next[search * 256 + joined[j]];
+            if (search == pattern_size && j >= carry_size) {
+                int last = job->first_newline == -1 ? job->header.raw_size : job->first_newline;
+                match_line line = {job->offset, last, NULL, 1, job->first_newline == -1};
+                nlines += print_line(&state, &reader, i, &line, &last_start);
+                break;
+            }
+        }
+
+        for (int l = 0; l < job->nlines; l++) {
+            nlines += print_line(&state, &reader, i, &job->lines[l], &last_start);
+            free(job->lines[l].text);
+        }
+        free(job->lines);
+
+        // keep the last symbols of the source read so far
+        if (job->tail_size == state.context) {
+            memcpy(carry, job->tail, job->tail_size);
+            carry_size = job->tail_size;
+        } else {
+            int keep = joined_size < state.context ? joined_size : state.context;
+            memmove(carry, joined + joined_size - keep, keep);
+            carry_size = keep;
+        }
+        free(job->head);
+        free(job->tail);
+        job->head = job->tail = NULL;
+    }
+    if (nlines == 0)
+        status = 1; // like grep, nothing found
+
+    if (countflag)
+        printf("%d\n", nlines);
+    t_end = clock() - t_start;
+    if (debugflag)
+        printf(DEBUG_TXT "Duration(TOTAL): %f seconds\n" RESET_TXT, ((double)t_end) / CLOCKS_PER_SEC);
+
+    // memory cleanup
+    for (int i = 0; i < state.header.block_count; i++) {
+        free(state.jobs[i].head);
+        free(state.jobs[i].tail);
+    }
+    if (reader.table)
+        phrases_free(reader.table);
+    if (reader.file)
+        fclose(reader.file);
+    pthread_mutex_destroy(&state.lock);
+    dfa_free(state.dfa);
+    free(threads);
+    free(state.jobs);
+    free(joined);
+    free(carry);
+    return status;
+}
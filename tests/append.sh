@@ -0,0 +1,65 @@
+#!/bin/sh
+# -o puts several sources in one compressed file, -a adds to it and -r without a file starts one.
+# -r carries on a compression (or with -a an append) cut in the middle of a block.
+# Run from the repository root after make build lzwd lzwgrep.
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/lzwtest-XXXXXX")
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+head -c 30000 lzwd_lib.c > "$dir/a.txt"
+head -c 20000 lzw.c > "$dir/b.txt"
+cat "$dir/a.txt" "$dir/b.txt" "$dir/a.txt" "$dir/b.txt" > "$dir/all.txt"
+
+# leaves a compressed file as an interrupted job would: header of before the job, last block cut
+interrupt() {
+    dd if="$2" of="$1" bs=32 count=1 conv=notrunc 2> /dev/null
+    size=$(wc -c < "$1")
+    dd if=/dev/null of="$1" bs=1 seek=$((size - 10)) 2> /dev/null
+}
+
+# same lines at the same offsets as the sources one after the other
+check() {
+    grep -bF int "$1" > "$dir/want"
+    ./lzwgrep -b int "$2" > "$dir/got"
+    if ! cmp -s "$dir/want" "$dir/got"; then
+        echo "FAIL: $3"
+        fail=1
+    fi
+}
+
+for algo in lzw lzwd; do
+    ./$algo -D -s 1000 -o "$dir/pack.$algo" "$dir/a.txt" "$dir/b.txt" "$dir/a.txt" > /dev/null || fail=1
+    ./$algo -a -o "$dir/pack.$algo" "$dir/b.txt" > /dev/null || fail=1
+    check "$dir/all.txt" "$dir/pack.$algo" "$algo -o then -a -o"
+
+    rm -f "$dir/a.$algo"
+    ./$algo -r "$dir/a.txt" > /dev/null || fail=1
+    check "$dir/a.txt" "$dir/a.$algo" "$algo -r without a compressed file"
+
+    # interrupted compression: the header counts no blocks yet
+    ./$algo -s 1000 "$dir/a.txt" > /dev/null || fail=1
+    head -c 32 "$dir/a.$algo" > "$dir/header"
+    dd if=/dev/zero of="$dir/header" bs=1 seek=12 count=12 conv=notrunc 2> /dev/null
+    interrupt "$dir/a.$algo" "$dir/header"
+    if ! ./$algo -r "$dir/a.txt" | grep -q "Resumed at source byte"; then
+        echo "FAIL: $algo -r started the interrupted compression again"
+        fail=1
+    fi
+    check "$dir/a.txt" "$dir/a.$algo" "$algo -r after an interrupted compression"
+
+    # interrupted append: the header counts the blocks of a.txt only
+    cp "$dir/a.$algo" "$dir/ab.$algo"
+    head -c 32 "$dir/ab.$algo" > "$dir/header"
+    ./$algo -a -o "$dir/ab.$algo" "$dir/b.txt" > /dev/null || fail=1
+    interrupt "$dir/ab.$algo" "$dir/header"
+    if ! ./$algo -a -r -o "$dir/ab.$algo" "$dir/b.txt" | grep -q "Resumed at source byte"; then
+        echo "FAIL: $algo -a -r started the interrupted append again"
+        fail=1
+    fi
+    cat "$dir/a.txt" "$dir/b.txt" > "$dir/ab.txt"
+    check "$dir/ab.txt" "$dir/ab.$algo" "$algo -a -r after an interrupted append"
+done
+
+[ $fail -eq 0 ] && echo "append: ok"
+exit $fail
@@ -0,0 +1,47 @@
+#!/bin/sh
+# -s auto must keep the defaults on files too small to sample, never pick sizes that compress much
+# worse than the defaults, and its archives must read back like any other.
+# Run from the repository root after make build lzwd lzwgrep.
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/lzwtest-XXXXXX")
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+cat *.c | head -c 100000 > "$dir/small.txt"
+for algo in lzw lzwd; do
+    ./$algo "$dir/small.txt" > /dev/null || fail=1
+    mv "$dir/small.$algo" "$dir/plain.$algo"
+    ./$algo "$dir/small.txt" -s auto > "$dir/out" || fail=1
+    if ! cmp -s "$dir/small.$algo" "$dir/plain.$algo"; then
+        echo "FAIL: $algo -s auto changed the archive of a file too small to sample"
+        fail=1
+    fi
+done
+
+# big enough for trials of every dictionary size and of bigger blocks
+i=0
+while [ $i -lt 40 ]; do
+    cat *.c
+    i=$((i + 1))
+done | head -c 2000000 > "$dir/big.txt"
+./lzw "$dir/big.txt" > /dev/null || fail=1
+plain=$(wc -c < "$dir/big.lzw")
+./lzw "$dir/big.txt" -s auto > "$dir/out" || fail=1
+auto=$(wc -c < "$dir/big.lzw")
+if [ $((auto * 100)) -gt $((plain * 102)) ]; then
+    echo "FAIL: lzw -s auto: $auto bytes, $plain with the defaults"
+    fail=1
+fi
+if ! grep -aq "Dictionary size picked: 4096" "$dir/out"; then
+    echo "FAIL: lzw -s auto: $(grep -a "picked" "$dir/out")"
+    fail=1
+fi
+grep -bF -- "int" "$dir/big.txt" > "$dir/want"
+./lzwgrep -b -- "int" "$dir/big.lzw" > "$dir/got"
+if ! cmp -s "$dir/want" "$dir/got"; then
+    echo "FAIL: lzwgrep on a -s auto archive differs from grep"
+    fail=1
+fi
+
+[ $fail -eq 0 ] && echo "auto: ok"
+exit $fail
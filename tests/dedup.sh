@@ -0,0 +1,45 @@
+#!/bin/sh
+# Every block repeated from a previous file of a batch must be written as a reference, references
+# to blocks of other archives must still resolve when searched from another directory, and a batch
+# must not write two sources to the same compressed file.
+# Run from the repository root after make build lzwd lzwgrep.
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/lzwtest-XXXXXX")
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+mkdir "$dir/one" "$dir/two"
+head -c 40000 lzwd_lib.c > "$dir/one/a.txt"
+cat "$dir/one/a.txt" lzw.c > "$dir/one/b.txt"
+cp "$dir/one/b.txt" "$dir/two/c.txt"
+
+for algo in lzw lzwd; do
+    (cd "$dir" && "$OLDPWD/$algo" -D -s 1000 one/a.txt one/b.txt two/c.txt > /dev/null) || fail=1
+    want=$(grep -c int "$dir/one/b.txt")
+    for archive in one/b two/c; do
+        count=$(./lzwgrep -c int "$dir/$archive.$algo")
+        here=$(cd "$dir/$(dirname $archive)" && "$OLDPWD/lzwgrep" -c int "$(basename $archive).$algo")
+        if [ "$count" != "$want" ] || [ "$here" != "$want" ]; then
+            echo "FAIL: $algo $archive: $count and $here lines, $want with grep"
+            fail=1
+        fi
+    done
+
+    cp "$dir/one/b.txt" "$dir/copy.txt"
+    blocks=$(( ($(wc -c < "$dir/copy.txt") + 999) / 1000 ))
+    repeated=$(./$algo -D -s 1000 "$dir/one/b.txt" "$dir/copy.txt" | grep "Repeated blocks" | tail -n 1)
+    if [ "$repeated" != "Repeated blocks: $blocks" ]; then
+        echo "FAIL: $algo copy of a file: $repeated of $blocks blocks"
+        fail=1
+    fi
+
+    cp "$dir/one/a.txt" "$dir/app.log.1"
+    cp "$dir/one/b.txt" "$dir/app.log.2"
+    if ./$algo -D "$dir/app.log.1" "$dir/app.log.2" > /dev/null; then
+        echo "FAIL: $algo compressed app.log.1 and app.log.2 to the same file"
+        fail=1
+    fi
+done
+
+[ $fail -eq 0 ] && echo "dedup: ok"
+exit $fail
@@ -0,0 +1,35 @@
+#!/bin/sh
+# lzwgrep must print the same lines as grep -F, at any block size (even for lines longer than a block)
+# and with huffman coded indexes (-e).
+# Run from the repository root after make build lzwd lzwgrep.
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/lzwtest-XXXXXX")
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+cat lzwd_lib.c lzwd_compress.c lzwgrep.c | head -c 80000 > "$dir/src.txt"
+awk 'BEGIN { for (i = 0; i < 30; i++) { s = ""; for (j = 0; j < i * 20; j++) s = s "e int x"; print s "dict_size end" } }' >> "$dir/src.txt"
+printf 'last line without newline int' >> "$dir/src.txt"
+
+for algo in lzw lzwd; do
+    for options in "-s 5" "-s 50" "" "-e -s 4000" "-e"; do
+        ./$algo "$dir/src.txt" $options > /dev/null || fail=1
+        for pattern in int e dict_size "int i" "end" "newline int"; do
+            grep -bF -- "$pattern" "$dir/src.txt" > "$dir/want"
+            ./lzwgrep -b -- "$pattern" "$dir/src.$algo" > "$dir/got"
+            want=$(grep -cF -- "$pattern" "$dir/src.txt")
+            count=$(./lzwgrep -c -- "$pattern" "$dir/src.$algo")
+            if ! cmp -s "$dir/want" "$dir/got" || [ "$count" != "$want" ]; then
+                echo "FAIL: $algo $options '$pattern': $count lines, $want with grep"
+                fail=1
+            fi
+        done
+        if ./lzwgrep -c "not in the file" "$dir/src.$algo" > /dev/null; then
+            echo "FAIL: $algo $options: exit status 0 without matches"
+            fail=1
+        fi
+    done
+done
+
+[ $fail -eq 0 ] && echo "grep: ok"
+exit $fail
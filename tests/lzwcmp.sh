@@ -0,0 +1,34 @@
+#!/bin/sh
+# lzwcmp must report for every algorithm the bytes lzw and lzwd write for the same blocks (their
+# compressed file without its header), and reject invalid block sizes.
+# Run from the repository root after make build lzwd lzwcmp.
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/lzwtest-XXXXXX")
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+cat lzwd_lib.c lzwd_compress.c | head -c 40000 > "$dir/src.txt"
+
+for size in 50 4000; do
+    ./lzwcmp -s $size "$dir/src.txt" > "$dir/out" || fail=1
+    for algo in lzw lzwd; do
+        ./$algo -s $size "$dir/src.txt" > /dev/null || fail=1
+        want=$(( $(wc -c < "$dir/src.$algo") - 32 ))
+        case $algo in lzw) name=LZW ;; lzwd) name=LZWd ;; esac
+        got=$(grep "^$name: " "$dir/out" | cut -d ' ' -f 2)
+        if [ "$got" != "$want" ]; then
+            echo "FAIL: lzwcmp -s $size reports $got bytes for $algo, it writes $want"
+            fail=1
+        fi
+    done
+done
+
+for size in 0 -1 abc; do
+    if ./lzwcmp -s $size "$dir/src.txt" > /dev/null; then
+        echo "FAIL: lzwcmp accepted -s $size"
+        fail=1
+    fi
+done
+
+[ $fail -eq 0 ] && echo "lzwcmp: ok"
+exit $fail
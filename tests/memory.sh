@@ -0,0 +1,53 @@
+#!/bin/sh
+# -M must keep compressing (appends included) within the memory given, checked with ulimit -d,
+# and the archives must read back like any other.
+# Run from the repository root after make build lzwd lzwgrep.
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/lzwtest-XXXXXX")
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+cat *.c | head -c 200000 > "$dir/a.txt"
+cat *.h *.c | head -c 150000 > "$dir/b.txt"
+i=0
+while [ $i -lt 30 ]; do
+    cat *.c
+    i=$((i + 1))
+done | head -c 3000000 > "$dir/big.txt"
+
+# archive of the files given must hold what grep finds in them
+check() {
+    name=$1
+    archive=$2
+    shift 2
+    cat "$@" | grep -bF -- "int" > "$dir/want"
+    ./lzwgrep -b -- "int" "$archive" > "$dir/got" 2> /dev/null
+    if ! cmp -s "$dir/want" "$dir/got"; then
+        echo "FAIL: $name: lzwgrep differs from grep"
+        fail=1
+    fi
+}
+
+for algo in lzw lzwd; do
+    # -M lowers the block size of the first file, the second one is appended with it
+    rm -f "$dir/pack"
+    if ! (ulimit -d 600; ./$algo -s 64000 -M 600K -o "$dir/pack" "$dir/a.txt" "$dir/b.txt" > "$dir/out"); then
+        echo "FAIL: $algo -s 64000 -M 600K -o: $(tail -1 "$dir/out")"
+        fail=1
+    fi
+    check "$algo -M 600K" "$dir/pack" "$dir/a.txt" "$dir/b.txt"
+    grep -a "^Memory:" "$dir/out" | while read -r label used of limit rest; do
+        if [ "$used" -gt "$limit" ]; then
+            echo "FAIL: $algo -M 600K: reported $used of $limit bytes"
+            exit 1
+        fi
+    done || fail=1
+done
+
+# 4Mb blocks take about 30Mb without -M
+rm -f "$dir/pack"
+(ulimit -d 4096; ./lzw -s 4000000 -M 4M -o "$dir/pack" "$dir/big.txt" "$dir/a.txt" > /dev/null 2>&1) || fail=1
+check "lzw -s 4000000 -M 4M" "$dir/pack" "$dir/big.txt" "$dir/a.txt"
+
+[ $fail -eq 0 ] && echo "memory: ok"
+exit $fail
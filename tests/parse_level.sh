@@ -0,0 +1,38 @@
+#!/bin/sh
+# Flexible parsing (-l) must never make lzwd output bigger than greedy parsing (level 0), and must
+# make it smaller on source code. lzw only parses greedily and rejects levels.
+# Run from the repository root after make build lzwd.
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/lzwtest-XXXXXX")
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+awk 'BEGIN { for (i = 0; i < 1000; i++) printf "ab" }' > "$dir/ab.txt"
+awk 'BEGIN { for (i = 0; i < 20000; i++) printf "a" }' > "$dir/aa.txt"
+awk 'BEGIN { for (i = 0; i < 2000; i++) printf "abcababcababcabc" }' > "$dir/abc.txt"
+head -c 60000 lzwd_lib.c > "$dir/src.txt"
+
+for input in ab aa abc src; do
+    ./lzwd "$dir/$input.txt" > /dev/null || fail=1
+    greedy=$(wc -c < "$dir/$input.lzwd")
+    for level in 1 3 9; do
+        ./lzwd "$dir/$input.txt" -l $level > /dev/null || fail=1
+        size=$(wc -c < "$dir/$input.lzwd")
+        if [ "$size" -gt "$greedy" ]; then
+            echo "FAIL: lzwd -l $level on $input: $size bytes, $greedy at level 0"
+            fail=1
+        fi
+        if [ $input = src ] && [ $level = 9 ] && [ "$size" -ge "$greedy" ]; then
+            echo "FAIL: lzwd -l 9 on src: $size bytes, not smaller than $greedy at level 0"
+            fail=1
+        fi
+    done
+done
+
+if ./lzw "$dir/src.txt" -l 1 > /dev/null; then
+    echo "FAIL: lzw accepted -l 1"
+    fail=1
+fi
+
+[ $fail -eq 0 ] && echo "parse_level: ok"
+exit $fail